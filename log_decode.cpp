@@ -0,0 +1,120 @@
+#define LOGGER_NO_MAIN
+#include "test.cpp"
+
+#include <iomanip>
+#include <iterator>
+
+// Перетворює файл BinarySink назад у текстові рядки у форматі FileSink.
+// Визначення форматів ('F') читаються з самого файлу, тож декодеру не потрібен
+// процес, що писав журнал. Кільцевий файл MmapRingSink (наприклад, після
+// падіння) розпізнається за заголовком і виводиться як текст.
+
+struct DecodeOptions {
+    std::string path = "app.bin";
+    bool timestamps = false;
+};
+
+std::string_view level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::TRACE: return "TRACE";
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO:  return "INFO";
+        case LogLevel::WARN:  return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        default:              return "?";
+    }
+}
+
+void decode_log(std::string_view data, const DecodeOptions& options, std::ostream& out) {
+    if (data.substr(0, kBinaryLogMagic.size()) != kBinaryLogMagic) {
+        throw std::runtime_error("Not a binary log: " + options.path);
+    }
+
+    std::size_t pos = kBinaryLogMagic.size();
+    auto read_u32 = [&]() {
+        std::uint32_t value = 0;
+        if (data.size() - pos < sizeof(value)) {
+            throw std::runtime_error("Truncated binary log");
+        }
+        std::memcpy(&value, data.data() + pos, sizeof(value));
+        pos += sizeof(value);
+        return value;
+    };
+    auto read_bytes = [&](std::uint32_t size) {
+        if (data.size() - pos < size) {
+            throw std::runtime_error("Truncated binary log");
+        }
+        std::string_view bytes = data.substr(pos, size);
+        pos += size;
+        return bytes;
+    };
+
+    std::unordered_map<std::uint32_t, std::string_view> formats;
+    DecodedRecord record;
+    std::array<char, 4096> text;
+
+    while (pos < data.size()) {
+        char tag = data[pos++];
+        if (tag == 'F') {
+            std::uint32_t id = read_u32();
+            formats[id] = read_bytes(read_u32());
+        } else if (tag == 'R') {
+            if (!decode_log_record(read_bytes(read_u32()), record)) {
+                throw std::runtime_error("Corrupted record in binary log");
+            }
+            auto format = formats.find(record.format_id);
+            if (format == formats.end()) {
+                throw std::runtime_error("Record refers to unknown format " + std::to_string(record.format_id));
+            }
+
+            std::size_t size = format_log_message(text.data(), text.size(), format->second,
+                                                  record.args.data(), record.args.size());
+            if (options.timestamps) {
+                out << record.timestamp / 1'000'000'000 << "."
+                    << std::setw(9) << std::setfill('0') << record.timestamp % 1'000'000'000
+                    << " " << level_name(record.level) << " ";
+            }
+            out << "[File] ";
+            out.write(text.data(), static_cast<std::streamsize>(size));
+            out << '\n';
+        } else {
+            throw std::runtime_error("Unknown entry in binary log");
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    DecodeOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--timestamps") {
+            options.timestamps = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << "\n";
+            std::cerr << "Usage: ./log_decode [--timestamps] [FILE]\n";
+            return 1;
+        } else {
+            options.path = arg;
+        }
+    }
+
+    std::ifstream file(options.path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: Cannot open log file: " << options.path << "\n";
+        return 2;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    try {
+        if (std::string_view(data).substr(0, kRingLogMagic.size()) == kRingLogMagic) {
+            std::cout << read_ring_log(data);
+        } else {
+            decode_log(data, options, std::cout);
+        }
+    } catch (const std::exception& e) {
+        std::cout.flush();
+        std::cerr << "Error: " << e.what() << "\n";
+        return 2;
+    }
+    return 0;
+}
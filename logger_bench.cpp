@@ -0,0 +1,360 @@
+#define LOGGER_NO_MAIN
+#include "test.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <latch>
+
+// ===== Параметри бенчмарку =====
+
+struct BenchOptions {
+    std::size_t messages = 100'000;
+    unsigned threads = 0;
+    std::vector<std::string> sinks = { "none", "console", "console-buffered", "file", "binary", "mmap" };
+    std::string report;
+    bool check = false;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Під час вимірювань stdout (куди пише ConsoleSink і set_sink) перенаправлено
+// у /dev/null на рівні дескриптора, щоб звіт не змішувався з повідомленнями.
+class StdoutSilencer {
+    int saved_;
+
+public:
+    StdoutSilencer() : saved_(::dup(STDOUT_FILENO)) {
+        if (saved_ < 0) {
+            throw std::runtime_error("Cannot duplicate stdout");
+        }
+        int null_fd = ::open("/dev/null", O_WRONLY);
+        if (null_fd < 0) {
+            ::close(saved_);
+            throw std::runtime_error("Cannot open /dev/null");
+        }
+        std::cout.flush();
+        std::fflush(stdout);
+        ::dup2(null_fd, STDOUT_FILENO);
+        ::close(null_fd);
+    }
+
+    ~StdoutSilencer() {
+        std::cout.flush();
+        std::fflush(stdout);
+        ::dup2(saved_, STDOUT_FILENO);
+        ::close(saved_);
+    }
+
+    StdoutSilencer(const StdoutSilencer&) = delete;
+    StdoutSilencer& operator=(const StdoutSilencer&) = delete;
+};
+
+// Тимчасовий каталог для файлових sink'ів, видаляється разом з вмістом.
+class TempDir {
+    std::string path_;
+
+public:
+    TempDir() {
+        char name[] = "/tmp/logger_bench_XXXXXX";
+        if (::mkdtemp(name) == nullptr) {
+            throw std::runtime_error("Cannot create temporary directory");
+        }
+        path_ = name;
+    }
+
+    ~TempDir() {
+        for (const char* file : { "/bench.log", "/bench.bin", "/bench.ring" }) {
+            std::remove((path_ + file).c_str());
+        }
+        ::rmdir(path_.c_str());
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    std::string file(const char* name) const { return path_ + "/" + name; }
+};
+
+// ===== Вимірювання =====
+
+struct BenchResult {
+    std::string sink;
+    bool async = false;
+    unsigned threads = 0;
+    std::size_t messages = 0;
+    double seconds = 0;
+    double p50_ns = 0;
+    double p99_ns = 0;
+    double p999_ns = 0;
+    std::uint64_t dropped = 0;
+};
+
+double percentile(const std::vector<std::uint32_t>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(q * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+SinkType bench_sink_type(const std::string& name, SinkSettings& settings) {
+    settings.console_buffered = name == "console-buffered";
+    return parse_sink_type(settings.console_buffered ? "console" : name);
+}
+
+// Кожен потік вимірює кожен виклик log(); пропускна здатність рахується від
+// спільного старту до завершення flush(), тож у асинхронному режимі включає
+// запис черги у sink.
+BenchResult run_case(const BenchOptions& options, const TempDir& dir, const std::string& sink,
+                     bool async, unsigned threads) {
+    Logger& logger = Logger::instance();
+    SinkSettings settings;
+    settings.file_path = dir.file("bench.log");
+    settings.binary_path = dir.file("bench.bin");
+    settings.ring_path = dir.file("bench.ring");
+    SinkType type = bench_sink_type(sink, settings);
+
+    logger.set_async(false);
+    logger.configure(settings);
+    logger.set_sink(type);
+    logger.set_level(LogLevel::INFO);
+    std::uint64_t dropped_before = logger.dropped_messages();
+    logger.set_async(async, 8192, OverflowPolicy::BLOCK);
+
+    std::vector<std::vector<std::uint32_t>> latencies(threads);
+    std::vector<std::thread> workers;
+    std::latch ready(threads + 1);
+    std::latch start(1);
+
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            auto& samples = latencies[t];
+            samples.reserve(options.messages);
+            ready.count_down();
+            start.wait();
+            for (std::size_t i = 0; i < options.messages; ++i) {
+                auto before = Clock::now();
+                logger.log("bench message {} from thread {}", i, t);
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count();
+                samples.push_back(static_cast<std::uint32_t>(std::min<std::int64_t>(ns, UINT32_MAX)));
+            }
+        });
+    }
+
+    ready.arrive_and_wait();
+    auto begin = Clock::now();
+    start.count_down();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    logger.flush();
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    BenchResult result;
+    result.sink = sink;
+    result.async = async;
+    result.threads = threads;
+    result.messages = options.messages * threads;
+    result.seconds = seconds;
+    result.dropped = logger.dropped_messages() - dropped_before;
+
+    std::vector<std::uint32_t> all;
+    all.reserve(result.messages);
+    for (auto& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    result.p50_ns = percentile(all, 0.50);
+    result.p99_ns = percentile(all, 0.99);
+    result.p999_ns = percentile(all, 0.999);
+
+    logger.set_async(false);
+    return result;
+}
+
+std::vector<BenchResult> run_benchmarks(const BenchOptions& options) {
+    unsigned max_threads = options.threads ? options.threads : std::max(4u, std::thread::hardware_concurrency());
+    std::vector<unsigned> thread_counts;
+    for (unsigned t = 1; t < max_threads; t *= 2) {
+        thread_counts.push_back(t);
+    }
+    thread_counts.push_back(max_threads);
+
+    TempDir dir;
+    std::vector<BenchResult> results;
+    for (const auto& sink : options.sinks) {
+        for (bool async : { false, true }) {
+            for (unsigned threads : thread_counts) {
+                BenchResult result;
+                {
+                    StdoutSilencer silence;
+                    result = run_case(options, dir, sink, async, threads);
+                    Logger::instance().set_sink(SinkType::NONE);
+                }
+                std::cerr << result.sink << (async ? "/async" : "/sync") << "/threads=" << threads << ": "
+                          << result.messages / result.seconds << " msg/s, p50 " << result.p50_ns
+                          << " ns, p99 " << result.p99_ns << " ns, p999 " << result.p999_ns << " ns" << std::endl;
+                results.push_back(result);
+            }
+        }
+    }
+    return results;
+}
+
+// ===== Перевірка =====
+
+// Потоки пишуть у FileSink, поки інший потік раз у раз замінює sink через
+// set_sink(). Кожне повідомлення має потрапити у файл рівно один раз: буфер
+// потоку не можна злити двічі чи загубити, хоч би через яку версію слоту
+// його зливали.
+bool check_set_sink(const TempDir& dir) {
+    constexpr unsigned kThreads = 4;
+    constexpr std::size_t kMessages = 20'000;
+    constexpr int kSwaps = 200;
+
+    Logger& logger = Logger::instance();
+    SinkSettings settings;
+    settings.file_path = dir.file("bench.log");
+    settings.file_flush_interval = std::chrono::milliseconds(0);
+    std::remove(settings.file_path.c_str());
+    {
+        StdoutSilencer silence;
+        logger.set_async(false);
+        logger.configure(settings);
+        logger.set_sink(SinkType::FILE);
+        logger.set_level(LogLevel::INFO);
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < kThreads; ++t) {
+            workers.emplace_back([&, t] {
+                for (std::size_t i = 0; i < kMessages; ++i) {
+                    logger.log("check {} {}", t, i);
+                }
+            });
+        }
+        std::thread swapper([&] {
+            for (int i = 0; i < kSwaps; ++i) {
+                logger.set_sink(SinkType::FILE);
+            }
+        });
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        swapper.join();
+        logger.flush();
+        logger.set_sink(SinkType::NONE);
+    }
+
+    std::ifstream file(settings.file_path);
+    std::size_t lines = 0;
+    for (std::string line; std::getline(file, line);) {
+        ++lines;
+    }
+    std::size_t expected = kThreads * kMessages;
+    std::cerr << "set_sink check: " << lines << " lines for " << expected << " messages" << std::endl;
+    return lines == expected;
+}
+
+// ===== Звіт =====
+
+void write_report(std::ostream& out, const BenchOptions& options, const std::vector<BenchResult>& results) {
+    out << "{\n";
+    out << "  \"messages_per_thread\": " << options.messages << ",\n";
+    out << "  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"sink\": \"" << r.sink << "\", \"mode\": \"" << (r.async ? "async" : "sync") << "\""
+            << ", \"threads\": " << r.threads
+            << ", \"messages\": " << r.messages
+            << ", \"seconds\": " << r.seconds
+            << ", \"messages_per_sec\": " << (r.seconds > 0 ? r.messages / r.seconds : 0)
+            << ", \"p50_ns\": " << r.p50_ns
+            << ", \"p99_ns\": " << r.p99_ns
+            << ", \"p999_ns\": " << r.p999_ns
+            << ", \"dropped\": " << r.dropped
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> items;
+    std::size_t begin = 0;
+    while (begin <= list.size()) {
+        std::size_t end = list.find(',', begin);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        if (end > begin) {
+            items.push_back(list.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return items;
+}
+
+BenchOptions parse_bench_options(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--messages=", 0) == 0) {
+            options.messages = std::stoull(arg.substr(11));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            options.threads = static_cast<unsigned>(std::stoul(arg.substr(10)));
+        } else if (arg.rfind("--sinks=", 0) == 0) {
+            options.sinks = split_list(arg.substr(8));
+        } else if (arg.rfind("--report=", 0) == 0) {
+            options.report = arg.substr(9);
+        } else if (arg == "--check") {
+            options.check = true;
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+
+    SinkSettings settings;
+    for (const auto& sink : options.sinks) {
+        bench_sink_type(sink, settings);
+    }
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    try {
+        options = parse_bench_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << "Usage: ./logger_bench [--messages=N] [--threads=N]"
+                  << " [--sinks=none,console,console-buffered,file,binary,mmap] [--report=FILE] [--check]" << std::endl;
+        return 1;
+    }
+
+    // Logger ще нічого не вивів: синхронізацію зі stdio можна вимкнути лише зараз.
+    if (std::find(options.sinks.begin(), options.sinks.end(), "console-buffered") != options.sinks.end()) {
+        unsync_console_from_stdio();
+    }
+
+    try {
+        if (options.check) {
+            TempDir dir;
+            return check_set_sink(dir) ? 0 : 3;
+        }
+        auto results = run_benchmarks(options);
+        if (options.report.empty()) {
+            write_report(std::cout, options, results);
+        } else {
+            std::ofstream report(options.report);
+            if (!report) {
+                throw std::runtime_error("Cannot open report file: " + options.report);
+            }
+            write_report(report, options, results);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
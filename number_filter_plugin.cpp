@@ -0,0 +1,65 @@
+#include "number_filter_plugin_api.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <new>
+#include <string_view>
+
+// Приклад плагіна фільтрів: DIV<n> пропускає числа, кратні n.
+//   g++ -std=c++20 -O2 -shared -fPIC number_filter_plugin.cpp -o number_filter_plugin.so
+//   ./number_pipeline --plugin=./number_filter_plugin.so DIV7 numbers.txt
+
+namespace {
+
+struct DivisibleFilter {
+    std::int64_t divisor;
+};
+
+void* create_div(const char* spec, char* error, std::size_t error_size) {
+    std::string_view text = spec;
+    text.remove_prefix(3);
+    std::int64_t divisor = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), divisor);
+    if (ec != std::errc() || end != text.data() + text.size() || divisor == 0) {
+        std::snprintf(error, error_size, "expected DIV<n> with non-zero n");
+        return nullptr;
+    }
+    // x % -1 переповнюється для найменшого значення, а кратні в -1 і 1 однакові.
+    return new (std::nothrow) DivisibleFilter{ divisor == -1 ? 1 : divisor };
+}
+
+void destroy_div(void* filter) {
+    delete static_cast<DivisibleFilter*>(filter);
+}
+
+template <class T>
+std::size_t keep_div(const void* filter, const T* input, std::size_t n, T* out) {
+    std::int64_t divisor = static_cast<const DivisibleFilter*>(filter)->divisor;
+    std::size_t kept = 0;
+    if (divisor >= std::numeric_limits<T>::min() && divisor <= std::numeric_limits<T>::max()) {
+        T d = static_cast<T>(divisor);
+        for (std::size_t i = 0; i < n; ++i) {
+            out[kept] = input[i];
+            kept += input[i] % d == 0;
+        }
+    } else {
+        // Дільник поза діапазоном T: кратний лише 0.
+        for (std::size_t i = 0; i < n; ++i) {
+            out[kept] = input[i];
+            kept += input[i] == 0;
+        }
+    }
+    return kept;
+}
+
+constexpr NumberFilterPluginApi kDivisibleApi = {
+    NUMBER_FILTER_PLUGIN_VERSION, "DIV", &create_div, &destroy_div, &keep_div<std::int32_t>, &keep_div<std::int64_t>,
+};
+
+} // namespace
+
+const NumberFilterPluginApi* number_filter_plugin() {
+    return &kDivisibleApi;
+}
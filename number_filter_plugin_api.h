@@ -0,0 +1,45 @@
+#ifndef NUMBER_FILTER_PLUGIN_API_H
+#define NUMBER_FILTER_PLUGIN_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ABI плагінів фільтрів для number_pipeline --plugin=PATH. Заголовок сумісний
+// з C, тож плагін не залежить від number_pipeline.cpp і може бути написаний
+// будь-якою мовою з C-інтерфейсом.
+//
+// Спільна бібліотека експортує NUMBER_FILTER_PLUGIN_SYMBOL. Фільтр створюється
+// з повного тексту (наприклад, "DIV7") і працює лише блоками: одне непряме
+// звертання на блок, а не на кожне значення. Функції плагіна не повинні
+// кидати винятків.
+
+#define NUMBER_FILTER_PLUGIN_VERSION 1u
+#define NUMBER_FILTER_PLUGIN_SYMBOL "number_filter_plugin"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct NumberFilterPluginApi {
+    // NUMBER_FILTER_PLUGIN_VERSION, з яким зібрано плагін.
+    uint32_t version;
+    // Префікс, за яким FilterFactory обирає цей плагін.
+    const char* name;
+    // Повертає стан фільтра або NULL для некоректного spec; опис помилки
+    // можна записати в error (разом з '\0' не довше за error_size).
+    void* (*create)(const char* spec, char* error, size_t error_size);
+    void (*destroy)(void* filter);
+    // Семантика keep_batch: копіює в out значення з input, які пропускає
+    // фільтр, і повертає їх кількість. NULL — плагін не підтримує цей тип.
+    size_t (*keep_batch_int32)(const void* filter, const int32_t* input, size_t n, int32_t* out);
+    size_t (*keep_batch_int64)(const void* filter, const int64_t* input, size_t n, int64_t* out);
+} NumberFilterPluginApi;
+
+// Точка входу, яку реалізує плагін. Таблиця має жити, доки бібліотеку завантажено.
+const NumberFilterPluginApi* number_filter_plugin(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,184 +6,3907 @@
 #include <memory>
 #include <map>
 #include <functional>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <span>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <array>
+#include <bit>
+#include <climits>
+#include <charconv>
+#include <cctype>
+#include <cmath>
+#include <utility>
+#include <limits>
+#include <type_traits>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+#include "number_filter_plugin_api.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 // ===== Інтерфейси =====
 
-class INumberReader {
+constexpr std::size_t kDefaultChunkSize = 64 * 1024;
+
+struct PipelineStats;
+inline std::size_t estimate_value_count(const std::string& filename);
+
+// Конвеєр параметризований типом значень T — int або std::int64_t. Імена
+// без префікса Basic (INumberStream, NumberProcessor, ...) — псевдоніми для int.
+
+// Pull-потік чисел: кожен next_chunk() повертає не більше chunk_size значень,
+// порожній span означає кінець даних. Span валідний до наступного виклику.
+template <class T>
+class BasicNumberStream {
 public:
-    virtual std::vector<int> read_numbers(const std::string& filename) = 0;
-    virtual ~INumberReader() = default;
+    virtual std::span<const T> next_chunk() = 0;
+
+    // Потік, що підтримує --stats, додає сюди прочитані байти і час у read().
+    virtual void collect_stats(PipelineStats*) {}
+    virtual ~BasicNumberStream() = default;
 };
 
-class INumberFilter {
+template <class T>
+class BasicNumberReader {
 public:
-    virtual bool keep(int number) const = 0;
-    virtual ~INumberFilter() = default;
+    virtual std::unique_ptr<BasicNumberStream<T>> open_stream(const std::string& filename, std::size_t chunk_size) = 0;
+
+    // Заповнює numbers, зберігаючи його ємність між викликами; місце
+    // резервується одразу за оцінкою з розміру файлу.
+    virtual void read_numbers(const std::string& filename, std::vector<T>& numbers) {
+        numbers.clear();
+        numbers.reserve(estimate_value_count(filename));
+
+        auto stream = open_stream(filename, kDefaultChunkSize);
+        for (auto chunk = stream->next_chunk(); !chunk.empty(); chunk = stream->next_chunk()) {
+            numbers.insert(numbers.end(), chunk.begin(), chunk.end());
+        }
+    }
+
+    virtual std::vector<T> read_numbers(const std::string& filename) {
+        std::vector<T> numbers;
+        read_numbers(filename, numbers);
+        return numbers;
+    }
+
+    virtual ~BasicNumberReader() = default;
 };
 
-class INumberObserver {
-public:
-    virtual void on_number(int number) = 0;
-    virtual void on_finished() = 0;
-    virtual ~INumberObserver() = default;
+// Статистика блоку бінарного файлу: межі значень і кількість парних.
+// Бінарний формат зберігає лише int32.
+struct BlockStats {
+    int min = 0;
+    int max = 0;
+    std::size_t count = 0;
+    std::size_t even_count = 0;
 };
 
-// ===== Реалізація зчитування =====
+enum class BlockMatch { NONE, ALL, MIXED };
 
-class FileNumberReader : public INumberReader {
+template <class T>
+class BasicNumberFilter {
 public:
-    std::vector<int> read_numbers(const std::string& filename) override {
-        std::ifstream file(filename);
-        if (!file) {
-            throw std::runtime_error("Cannot open file: " + filename);
-        }
+    using value_type = T;
 
-        std::vector<int> numbers;
-        int num;
-        while (file >> num) {
-            numbers.push_back(num);
+    virtual bool keep(T number) const = 0;
+
+    // Записує в out значення з input, які проходять фільтр, і повертає їх кількість.
+    // out має вміщати input.size() елементів.
+    virtual std::size_t keep_batch(std::span<const T> input, T* out) const {
+        std::size_t kept = 0;
+        for (T number : input) {
+            out[kept] = number;
+            kept += keep(number);
         }
+        return kept;
+    }
 
-        return numbers;
+    // Відповідь за статистикою блоку без перегляду значень: NONE — жодне
+    // значення не пройде, ALL — пройдуть усі, MIXED — треба фільтрувати.
+    virtual BlockMatch classify_block(const BlockStats&) const {
+        return BlockMatch::MIXED;
     }
+
+    virtual ~BasicNumberFilter() = default;
 };
 
-// ===== Реалізації фільтрів =====
+template <class T>
+class BasicNumberObserver {
+public:
+    virtual void on_number(T number) = 0;
+
+    // Блок відфільтрованих значень; за замовчуванням розкладається на on_number.
+    virtual void on_batch(std::span<const T> numbers) {
+        for (T number : numbers) {
+            on_number(number);
+        }
+    }
+
+    // false — обсерверу досить кількості значень (CountObserver). Якщо так
+    // влаштовані всі обсервери, блоки, які фільтр приймає цілком за індексом,
+    // не розпаковуються, а приходять як on_count().
+    virtual bool needs_values() const {
+        return true;
+    }
+
+    virtual void on_count(std::size_t) {}
 
-class EvenFilter : public INumberFilter {
+    // Виводить поточний підсумок. У режимі --follow викликається після кожної
+    // порції дописаних даних, тож не повинен скидати накопичений стан.
+    virtual void on_finished() = 0;
+    virtual ~BasicNumberObserver() = default;
+};
+
+// Обсервер-агрегат: у паралельному режимі кожен шматок вхідних даних отримує
+// власний частковий стан, які потім зливаються в основний обсервер.
+template <class T>
+class BasicMergeableObserver : public BasicNumberObserver<T> {
 public:
-    bool keep(int number) const override {
-        return number % 2 == 0;
+    virtual std::unique_ptr<BasicMergeableObserver> make_partial() const = 0;
+    virtual void merge(const BasicMergeableObserver& partial) = 0;
+};
+
+using INumberStream = BasicNumberStream<int>;
+using INumberReader = BasicNumberReader<int>;
+using INumberFilter = BasicNumberFilter<int>;
+using INumberObserver = BasicNumberObserver<int>;
+using IMergeableObserver = BasicMergeableObserver<int>;
+
+// ===== Статистика етапів =====
+
+using StatsClock = std::chrono::steady_clock;
+
+// Лічильники --stats. Час — у наносекундах; у паралельному режимі час етапів
+// підсумовується по всіх воркерах, тож може перевищувати total.
+struct PipelineStats {
+    std::uint64_t total_ns = 0;
+    // Очікування даних у read()/poll() читача.
+    std::uint64_t read_ns = 0;
+    // Розбір тексту або розпаковка блоків, без read_ns.
+    std::uint64_t parse_ns = 0;
+    std::uint64_t filter_ns = 0;
+    std::uint64_t observer_ns = 0;
+    std::uint64_t bytes_read = 0;
+    std::uint64_t values_parsed = 0;
+    // Бінарний формат: блоки всього і скільки з них довелося розпакувати.
+    std::uint64_t blocks = 0;
+    std::uint64_t blocks_decoded = 0;
+    unsigned threads = 1;
+    // Кількість значень, які пропустив фільтр кожного запиту.
+    std::vector<std::uint64_t> selected;
+
+    void merge(const PipelineStats& other) {
+        read_ns += other.read_ns;
+        parse_ns += other.parse_ns;
+        filter_ns += other.filter_ns;
+        observer_ns += other.observer_ns;
+        bytes_read += other.bytes_read;
+        values_parsed += other.values_parsed;
+        blocks += other.blocks;
+        blocks_decoded += other.blocks_decoded;
+        selected.resize(std::max(selected.size(), other.selected.size()));
+        for (std::size_t q = 0; q < other.selected.size(); ++q) {
+            selected[q] += other.selected[q];
+        }
     }
 };
 
-class OddFilter : public INumberFilter {
+// Додає час від попередньої позначки до вказаного лічильника. Без
+// PipelineStats годинник не викликається взагалі.
+class StageTimer {
+    PipelineStats* stats;
+    StatsClock::time_point last;
+
 public:
-    bool keep(int number) const override {
-        return number % 2 != 0;
+    explicit StageTimer(PipelineStats* s) : stats(s) {
+        if (stats) {
+            last = StatsClock::now();
+        }
+    }
+
+    void lap(std::uint64_t PipelineStats::*counter) {
+        if (!stats) {
+            return;
+        }
+        auto now = StatsClock::now();
+        stats->*counter += static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+        last = now;
     }
 };
 
-class GreaterThanFilter : public INumberFilter {
-    int threshold;
+inline void write_stats(std::ostream& out, const PipelineStats& stats, const std::vector<std::string>& labels,
+                        bool json) {
+    auto ms = [](std::uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+    auto share = [&](std::size_t q) {
+        return stats.values_parsed ? static_cast<double>(stats.selected[q]) / static_cast<double>(stats.values_parsed)
+                                   : 0.0;
+    };
+
+    if (json) {
+        out << "{\"total_ns\": " << stats.total_ns
+            << ", \"read_ns\": " << stats.read_ns
+            << ", \"parse_ns\": " << stats.parse_ns
+            << ", \"filter_ns\": " << stats.filter_ns
+            << ", \"observer_ns\": " << stats.observer_ns
+            << ", \"threads\": " << stats.threads
+            << ", \"bytes_read\": " << stats.bytes_read
+            << ", \"values_parsed\": " << stats.values_parsed
+            << ", \"blocks\": " << stats.blocks
+            << ", \"blocks_decoded\": " << stats.blocks_decoded
+            << ", \"queries\": [";
+        for (std::size_t q = 0; q < stats.selected.size(); ++q) {
+            out << (q ? ", " : "") << "{\"filter\": \"" << (q < labels.size() ? labels[q] : "") << "\""
+                << ", \"selected\": " << stats.selected[q]
+                << ", \"selectivity\": " << share(q) << "}";
+        }
+        out << "]}" << std::endl;
+        return;
+    }
+
+    out << "Stats:\n";
+    out << "  total:     " << ms(stats.total_ns) << " ms\n";
+    out << "  read:      " << ms(stats.read_ns) << " ms\n";
+    out << "  parse:     " << ms(stats.parse_ns) << " ms\n";
+    out << "  filter:    " << ms(stats.filter_ns) << " ms\n";
+    out << "  observers: " << ms(stats.observer_ns) << " ms\n";
+    if (stats.threads > 1) {
+        out << "  (stage times are summed over " << stats.threads << " threads)\n";
+    }
+    // Читач operator>> байтів не рахує.
+    if (stats.bytes_read > 0) {
+        out << "  bytes:     " << stats.bytes_read << " ("
+            << static_cast<double>(stats.bytes_read) * 1e3 / static_cast<double>(std::max<std::uint64_t>(stats.total_ns, 1))
+            << " MB/s)\n";
+    }
+    out << "  values:    " << stats.values_parsed << "\n";
+    if (stats.blocks > 0) {
+        out << "  blocks:    " << stats.blocks << " (decoded " << stats.blocks_decoded << ")\n";
+    }
+    for (std::size_t q = 0; q < stats.selected.size(); ++q) {
+        out << "  " << (q < labels.size() ? labels[q] : "filter") << ": " << stats.selected[q]
+            << " selected (" << share(q) * 100 << "%)\n";
+    }
+    out << std::flush;
+}
+
+// ===== Реалізація зчитування =====
+
+// Буфери, які потоки читача повертають після закриття. Коли один читач
+// обробляє багато файлів, наступний потік бере вже виділену пам'ять з уже
+// відображеними сторінками замість нової алокації.
+template <class T>
+class BufferPool {
+    std::mutex mutex;
+    std::vector<std::vector<T>> free;
+
 public:
-    explicit GreaterThanFilter(int t) : threshold(t) {}
+    std::vector<T> acquire() {
+        std::lock_guard lock(mutex);
+        if (free.empty()) {
+            return {};
+        }
+        std::vector<T> buffer = std::move(free.back());
+        free.pop_back();
+        return buffer;
+    }
 
-    bool keep(int number) const override {
-        return number > threshold;
+    void release(std::vector<T>&& buffer) {
+        if (buffer.capacity() == 0) {
+            return;
+        }
+        std::lock_guard lock(mutex);
+        free.push_back(std::move(buffer));
     }
 };
 
-// ===== Обсервери =====
+template <class T>
+struct StreamBuffers {
+    BufferPool<char> bytes;
+    BufferPool<T> values;
+};
+
+// Бере буфер з пулу при створенні й повертає в деструкторі; оголошується
+// після самого буфера, тож руйнується раніше за нього. Без пулу нічого не робить.
+template <class T>
+class BufferLease {
+    BufferPool<T>* pool;
+    std::vector<T>& buffer;
 
-class PrintObserver : public INumberObserver {
 public:
-    void on_number(int number) override {
-        std::cout << number << std::endl;
+    BufferLease(BufferPool<T>* p, std::vector<T>& b) : pool(p), buffer(b) {
+        if (pool) {
+            buffer = pool->acquire();
+        }
     }
 
-    void on_finished() override {}
+    ~BufferLease() {
+        if (pool) {
+            pool->release(std::move(buffer));
+        }
+    }
+
+    BufferLease(const BufferLease&) = delete;
+    BufferLease& operator=(const BufferLease&) = delete;
 };
 
-class CountObserver : public INumberObserver {
-    int count = 0;
+template <class T>
+inline BufferPool<char>* byte_pool(StreamBuffers<T>* buffers) {
+    return buffers ? &buffers->bytes : nullptr;
+}
+
+template <class T>
+inline BufferPool<T>* value_pool(StreamBuffers<T>* buffers) {
+    return buffers ? &buffers->values : nullptr;
+}
+
+// "-" читає стандартний вхід.
+template <class T>
+class FileNumberStream : public BasicNumberStream<T> {
+    std::ifstream file;
+    std::istream& in;
+    std::size_t chunk_size;
+    std::vector<T> buffer;
+    BufferLease<T> buffer_lease;
+
 public:
-    void on_number(int number) override {
-        ++count;
+    FileNumberStream(const std::string& filename, std::size_t chunk_size, StreamBuffers<T>* buffers = nullptr)
+        : in(filename == "-" ? std::cin : file), chunk_size(chunk_size), buffer_lease(value_pool(buffers), buffer) {
+        if (&in == &file) {
+            file.open(filename);
+        }
+        if (!in) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        if (chunk_size == 0) {
+            throw std::invalid_argument("Chunk size must be positive");
+        }
+        buffer.clear();
+        buffer.reserve(chunk_size);
     }
 
-    void on_finished() override {
-        std::cout << "Total numbers passed filter: " << count << std::endl;
+    std::span<const T> next_chunk() override {
+        buffer.clear();
+
+        T num;
+        while (buffer.size() < chunk_size && in >> num) {
+            buffer.push_back(num);
+        }
+
+        return buffer;
     }
 };
 
-// ===== Фабрика фільтрів через реєстр =====
+// Потоки не повинні переживати читача: вони повертають буфери в його пул.
+template <class T>
+class FileNumberReader final : public BasicNumberReader<T> {
+    StreamBuffers<T> buffers;
 
-class FilterFactory {
-    using FactoryFunction = std::function<std::unique_ptr<INumberFilter>(const std::string&)>;
-    std::map<std::string, FactoryFunction> registry;
+public:
+    std::unique_ptr<BasicNumberStream<T>> open_stream(const std::string& filename, std::size_t chunk_size) override {
+        return std::make_unique<FileNumberStream<T>>(filename, chunk_size, &buffers);
+    }
+};
+
+// ===== Швидкий розбір чисел =====
+
+// Та сама семантика, що й у `file >> num` для "C"-локалі: пробільні символи
+// пропускаються, знак '+'/'-' необов'язковий, розбір зупиняється на першому
+// некоректному токені або переповненні типу значень.
+inline bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Розбирає числа з [p, end) у out, доки їх не стане max_count. Повертає позицію,
+// з якої треба продовжити; failed встановлюється на некоректному токені.
+// Викликач гарантує, що end не розрізає токен навпіл.
+template <class T>
+inline const char* parse_numbers(const char* p, const char* end, std::vector<T>& out,
+                                 std::size_t max_count, bool& failed) {
+    while (out.size() < max_count) {
+        while (p != end && is_space(*p)) {
+            ++p;
+        }
+        if (p == end) {
+            break;
+        }
+
+        const char* token = p;
+        bool negative = false;
+        if (*p == '-' || *p == '+') {
+            negative = *p == '-';
+            ++p;
+        }
+
+        const std::uint64_t limit = static_cast<std::uint64_t>(std::numeric_limits<T>::max()) + negative;
+        const char* digits = p;
+        std::uint64_t value = 0;
+        while (p != end && static_cast<unsigned char>(*p - '0') < 10) {
+            unsigned digit = static_cast<unsigned>(*p - '0');
+            // Для int32 value * 10 не переповнить u64, тож межа перевіряється
+            // після множення; для int64 — до нього.
+            if constexpr (sizeof(T) < sizeof(std::uint64_t)) {
+                value = value * 10 + digit;
+                if (value > limit) {
+                    failed = true;
+                    return token;
+                }
+            } else {
+                if (value > (limit - digit) / 10) {
+                    failed = true;
+                    return token;
+                }
+                value = value * 10 + digit;
+            }
+            ++p;
+        }
+
+        if (p == digits) {
+            failed = true;
+            return token;
+        }
+
+        out.push_back(negative ? static_cast<T>(0 - value) : static_cast<T>(value));
+    }
+
+    return p;
+}
+
+class FileDescriptor {
+    int fd;
 
 public:
-    FilterFactory() {
-        registry["EVEN"] = [](const std::string&) {
-            return std::make_unique<EvenFilter>();
-        };
-        registry["ODD"] = [](const std::string&) {
-            return std::make_unique<OddFilter>();
-        };
-        registry["GT"] = [](const std::string& input) {
-            int threshold;
-            std::istringstream iss(input.substr(2));
-            if (!(iss >> threshold)) {
-                throw std::invalid_argument("Invalid GT filter format: " + input);
+    explicit FileDescriptor(int f) : fd(f) {}
+    ~FileDescriptor() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    int get() const { return fd; }
+};
+
+// "-" означає стандартний вхід, "/dev/fd/N" — вже відкритий дескриптор N
+// (зокрема сокет, який не відкрити повторно через /dev/fd). Дескриптор
+// дублюється, тож FileDescriptor закриває лише свою копію.
+inline int open_input(const std::string& filename) {
+    if (filename == "-") {
+        return ::dup(STDIN_FILENO);
+    }
+
+    constexpr std::string_view prefix = "/dev/fd/";
+    if (filename.starts_with(prefix) && filename.size() > prefix.size()) {
+        const char* begin = filename.data() + prefix.size();
+        const char* end = filename.data() + filename.size();
+        int fd = -1;
+        auto [ptr, ec] = std::from_chars(begin, end, fd);
+        if (ec == std::errc() && ptr == end) {
+            return ::dup(fd);
+        }
+    }
+
+    return ::open(filename.c_str(), O_RDONLY);
+}
+
+// Звичайний файл читається буфером за його розміром (не більшим за limit),
+// щоб дрібні файли не займали зайвих сторінок.
+inline std::size_t input_buffer_size(int fd, std::size_t limit) {
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        return std::clamp<std::size_t>(static_cast<std::size_t>(info.st_size) + 1, 4096, limit);
+    }
+    return limit;
+}
+
+// Кількість чисел у звичайному файлі, екстрапольована з перших 64 КіБ із
+// невеликим запасом; 0 — оцінити не вдалося (пайп, пристрій).
+inline std::size_t estimate_value_count(const std::string& filename) {
+    FileDescriptor fd(open_input(filename));
+    struct stat info;
+    if (fd.get() < 0 || ::fstat(fd.get(), &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        return 0;
+    }
+
+    std::array<char, 64 * 1024> sample;
+    ssize_t n = ::pread(fd.get(), sample.data(), sample.size(), 0);
+    if (n <= 0) {
+        return 0;
+    }
+
+    std::size_t tokens = 0;
+    bool in_token = false;
+    for (ssize_t i = 0; i < n; ++i) {
+        bool space = is_space(sample[i]);
+        tokens += !space && !in_token;
+        in_token = !space;
+    }
+    if (n == info.st_size) {
+        return tokens;
+    }
+    double scale = static_cast<double>(info.st_size) / static_cast<double>(n);
+    return static_cast<std::size_t>(static_cast<double>(tokens) * scale * 1.05) + 16;
+}
+
+template <class T>
+class FastFileNumberStream : public BasicNumberStream<T> {
+    static constexpr std::size_t kInitialBufferSize = 1 << 20;
+
+    FileDescriptor fd;
+    std::size_t chunk_size;
+    std::vector<T> values;
+    std::vector<char> bytes;
+    BufferLease<T> values_lease;
+    BufferLease<char> bytes_lease;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    std::size_t parse_end = 0;
+    bool eof = false;
+    bool failed = false;
+    PipelineStats* stats = nullptr;
+
+    // Дочитує дані в буфер і зсуває parse_end до останнього пробільного символу,
+    // щоб незавершений токен в кінці буфера дочекався наступного read().
+    void refill() {
+        if (begin > 0) {
+            std::memmove(bytes.data(), bytes.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+
+        do {
+            if (end == bytes.size()) {
+                bytes.resize(bytes.size() * 2);
             }
-            return std::make_unique<GreaterThanFilter>(threshold);
-        };
+
+            StageTimer timer(stats);
+            ssize_t n = ::read(fd.get(), bytes.data() + end, bytes.size() - end);
+            timer.lap(&PipelineStats::read_ns);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Read error: ") + std::strerror(errno));
+            }
+            if (n == 0) {
+                eof = true;
+                parse_end = end;
+                return;
+            }
+            if (stats) {
+                stats->bytes_read += static_cast<std::uint64_t>(n);
+            }
+
+            std::size_t scan = end;
+            end += static_cast<std::size_t>(n);
+            for (std::size_t i = end; i > scan; --i) {
+                if (is_space(bytes[i - 1])) {
+                    parse_end = i;
+                    return;
+                }
+            }
+        } while (true);
+    }
+
+public:
+    FastFileNumberStream(const std::string& filename, std::size_t chunk_size, StreamBuffers<T>* buffers = nullptr)
+        : fd(open_input(filename)), chunk_size(chunk_size),
+          values_lease(value_pool(buffers), values), bytes_lease(byte_pool(buffers), bytes) {
+        if (fd.get() < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        if (chunk_size == 0) {
+            throw std::invalid_argument("Chunk size must be positive");
+        }
+        bytes.resize(input_buffer_size(fd.get(), kInitialBufferSize));
+        values.clear();
+        values.reserve(chunk_size);
+    }
+
+    void collect_stats(PipelineStats* s) override {
+        stats = s;
     }
 
-    std::unique_ptr<INumberFilter> create_filter(const std::string& filter_str) const {
-        for (const auto& [key, factory] : registry) {
-            if (filter_str.rfind(key, 0) == 0) {
-                return factory(filter_str);
+    std::span<const T> next_chunk() override {
+        values.clear();
+
+        while (values.size() < chunk_size && !failed) {
+            if (begin == parse_end) {
+                if (eof) {
+                    break;
+                }
+                refill();
+                continue;
             }
+
+            const char* base = bytes.data();
+            const char* next = parse_numbers(base + begin, base + parse_end, values, chunk_size, failed);
+            begin = static_cast<std::size_t>(next - base);
         }
 
-        throw std::invalid_argument("Unknown filter: " + filter_str);
+        return values;
     }
 };
 
-// ===== Обробник чисел =====
-
-class NumberProcessor {
-    INumberReader& reader;
-    INumberFilter& filter;
-    std::vector<INumberObserver*> observers;
+template <class T>
+class FastFileNumberReader final : public BasicNumberReader<T> {
+    StreamBuffers<T> buffers;
 
 public:
-    NumberProcessor(INumberReader& r, INumberFilter& f, const std::vector<INumberObserver*>& obs)
-        : reader(r), filter(f), observers(obs) {}
+    std::unique_ptr<BasicNumberStream<T>> open_stream(const std::string& filename, std::size_t chunk_size) override {
+        return std::make_unique<FastFileNumberStream<T>>(filename, chunk_size, &buffers);
+    }
+};
 
-    void run(const std::string& filename) {
-        auto numbers = reader.read_numbers(filename);
+// ===== Асинхронне зчитування =====
+
+// Окремий потік читає дескриптор у один з двох буферів, поки споживач розбирає
+// інший, тож read() з пайпа перекривається з розбором і фільтрацією. Короткий
+// read() (у пайпі поки немає даних) одразу віддає прочитане, щоб повільний
+// продюсер не затримував обробку. Токен, розрізаний межею буферів, збирається
+// в carry.
+template <class T>
+class AsyncFileNumberStream : public BasicNumberStream<T> {
+    static constexpr std::size_t kBufferSize = 1 << 20;
+
+    struct Buffer {
+        std::vector<char> bytes;
+        std::size_t size = 0;
+        bool ready = false;
+        bool last = false;
+    };
+
+    FileDescriptor fd;
+    // eventfd, яким деструктор будить потік, що чекає даних у poll().
+    FileDescriptor wake;
+    std::size_t chunk_size;
+    StreamBuffers<T>* pool;
+    std::array<Buffer, 2> buffers;
+    std::mutex mutex;
+    std::condition_variable ready_changed;
+    bool stop = false;
+    std::exception_ptr error;
+    std::thread reader;
+
+    std::vector<T> values;
+    BufferLease<T> values_lease;
+    std::size_t current = 0;
+    bool holding = false;
+    bool finished = false;
+    bool failed = false;
+    const char* pos = nullptr;
+    const char* parse_end = nullptr;
+    const char* data_end = nullptr;
+    std::vector<char> carry;
+    std::vector<char> token;
+    const char* token_pos = nullptr;
+    const char* token_end = nullptr;
+    PipelineStats* stats = nullptr;
+
+    // Повертає true, коли дескриптор вичерпано або потік зупиняють.
+    bool read_buffer(Buffer& buffer) {
+        buffer.size = 0;
+        while (buffer.size < buffer.bytes.size()) {
+            if (buffer.size == 0) {
+                std::array<pollfd, 2> fds = { { { fd.get(), POLLIN, 0 }, { wake.get(), POLLIN, 0 } } };
+                if (::poll(fds.data(), fds.size(), -1) < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error(std::string("Poll error: ") + std::strerror(errno));
+                }
+                if (fds[1].revents != 0) {
+                    return true;
+                }
+            }
+
+            std::size_t requested = buffer.bytes.size() - buffer.size;
+            ssize_t n = ::read(fd.get(), buffer.bytes.data() + buffer.size, requested);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Read error: ") + std::strerror(errno));
+            }
+            if (n == 0) {
+                return true;
+            }
+            buffer.size += static_cast<std::size_t>(n);
+            if (static_cast<std::size_t>(n) < requested) {
+                break;
+            }
+        }
+        return false;
+    }
+
+    void fill() {
+        try {
+            for (std::size_t i = 0;; i ^= 1) {
+                Buffer& buffer = buffers[i];
+                {
+                    std::unique_lock lock(mutex);
+                    ready_changed.wait(lock, [&] { return stop || !buffer.ready; });
+                    if (stop) {
+                        return;
+                    }
+                }
 
-        for (int number : numbers) {
-            if (filter.keep(number)) {
-                for (auto* obs : observers) {
-                    obs->on_number(number);
+                bool last = read_buffer(buffer);
+                {
+                    std::lock_guard lock(mutex);
+                    buffer.last = last;
+                    buffer.ready = true;
                 }
+                ready_changed.notify_all();
+                if (last) {
+                    return;
+                }
+            }
+        } catch (...) {
+            std::lock_guard lock(mutex);
+            error = std::current_exception();
+            ready_changed.notify_all();
+        }
+    }
+
+    static const char* after_last_space(const char* begin, const char* end) {
+        while (end != begin && !is_space(end[-1])) {
+            --end;
+        }
+        return end;
+    }
+
+    // Віддає розібраний буфер потоку читання і бере наступний. Хвіст після
+    // останнього пробілу переходить у carry і дописується до першого токена
+    // наступного буфера.
+    bool advance() {
+        if (holding) {
+            carry.insert(carry.end(), parse_end, data_end);
+            {
+                std::lock_guard lock(mutex);
+                buffers[current].ready = false;
+            }
+            ready_changed.notify_all();
+            current ^= 1;
+            holding = false;
+        }
+        if (finished) {
+            return false;
+        }
+
+        Buffer& buffer = buffers[current];
+        StageTimer timer(stats);
+        {
+            std::unique_lock lock(mutex);
+            ready_changed.wait(lock, [&] { return buffer.ready || error; });
+            if (!buffer.ready) {
+                std::rethrow_exception(error);
+            }
+        }
+        timer.lap(&PipelineStats::read_ns);
+        if (stats) {
+            stats->bytes_read += buffer.size;
+        }
+        holding = true;
+        finished = buffer.last;
+        pos = buffer.bytes.data();
+        data_end = pos + buffer.size;
+
+        if (!carry.empty()) {
+            const char* space = std::find_if(pos, data_end, is_space);
+            carry.insert(carry.end(), pos, space);
+            pos = space;
+            if (space != data_end || finished) {
+                token.swap(carry);
+                carry.clear();
+                token_pos = token.data();
+                token_end = token_pos + token.size();
+            }
+        }
+        parse_end = finished ? data_end : after_last_space(pos, data_end);
+        return true;
+    }
+
+public:
+    AsyncFileNumberStream(const std::string& filename, std::size_t chunk_size, StreamBuffers<T>* buffers_pool = nullptr)
+        : fd(open_input(filename)), wake(::eventfd(0, EFD_CLOEXEC)), chunk_size(chunk_size), pool(buffers_pool),
+          values_lease(value_pool(buffers_pool), values) {
+        if (fd.get() < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        if (wake.get() < 0) {
+            throw std::runtime_error(std::string("Cannot create eventfd: ") + std::strerror(errno));
+        }
+        if (chunk_size == 0) {
+            throw std::invalid_argument("Chunk size must be positive");
+        }
+        std::size_t size = input_buffer_size(fd.get(), kBufferSize);
+        for (auto& buffer : buffers) {
+            if (pool) {
+                buffer.bytes = pool->bytes.acquire();
+            }
+            buffer.bytes.resize(size);
+        }
+        values.clear();
+        values.reserve(chunk_size);
+        reader = std::thread(&AsyncFileNumberStream::fill, this);
+    }
+
+    ~AsyncFileNumberStream() {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        ready_changed.notify_all();
+        std::uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = ::write(wake.get(), &one, sizeof(one));
+        reader.join();
+        if (pool) {
+            for (auto& buffer : buffers) {
+                pool->bytes.release(std::move(buffer.bytes));
             }
         }
+    }
+
+    AsyncFileNumberStream(const AsyncFileNumberStream&) = delete;
+    AsyncFileNumberStream& operator=(const AsyncFileNumberStream&) = delete;
 
-        for (auto* obs : observers) {
-            obs->on_finished();
+    void collect_stats(PipelineStats* s) override {
+        stats = s;
+    }
+
+    std::span<const T> next_chunk() override {
+        values.clear();
+
+        while (values.size() < chunk_size && !failed) {
+            if (token_pos != token_end) {
+                token_pos = parse_numbers(token_pos, token_end, values, chunk_size, failed);
+                continue;
+            }
+            if (pos == parse_end) {
+                if (!advance()) {
+                    break;
+                }
+                continue;
+            }
+            pos = parse_numbers(pos, parse_end, values, chunk_size, failed);
         }
+
+        return values;
     }
 };
 
-// ===== main =====
+template <class T>
+class AsyncFileNumberReader final : public BasicNumberReader<T> {
+    StreamBuffers<T> buffers;
 
-int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: ./number_pipeline <FILTER> <FILENAME>" << std::endl;
-        std::cerr << "Example: ./number_pipeline EVEN numbers.txt" << std::endl;
-        return 1;
+public:
+    std::unique_ptr<BasicNumberStream<T>> open_stream(const std::string& filename, std::size_t chunk_size) override {
+        return std::make_unique<AsyncFileNumberStream<T>>(filename, chunk_size, &buffers);
     }
+};
 
-    std::string filter_str = argv[1];
-    std::string filename = argv[2];
+// ===== Відображення файлів у пам'ять =====
 
-    try {
-        FilterFactory factory;
-        auto filter = factory.create_filter(filter_str);
+class MappedFile {
+    void* address = nullptr;
+    std::size_t length = 0;
+
+    MappedFile(void* a, std::size_t l) : address(a), length(l) {}
+
+public:
+    // Повертає nullptr для пайпів, пристроїв та інших не звичайних файлів,
+    // які не можна відобразити у пам'ять. Стандартний вхід, перенаправлений з
+    // файлу, відображається, якщо з нього ще нічого не прочитано.
+    static std::unique_ptr<MappedFile> open(const std::string& filename) {
+        FileDescriptor fd(open_input(filename));
+        if (fd.get() < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+
+        struct stat info;
+        if (::fstat(fd.get(), &info) != 0 || !S_ISREG(info.st_mode) || ::lseek(fd.get(), 0, SEEK_CUR) > 0) {
+            return nullptr;
+        }
+
+        std::size_t size = static_cast<std::size_t>(info.st_size);
+        if (size == 0) {
+            return std::unique_ptr<MappedFile>(new MappedFile(nullptr, 0));
+        }
+
+        void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+        if (address == MAP_FAILED) {
+            return nullptr;
+        }
+        ::madvise(address, size, MADV_SEQUENTIAL);
+
+        return std::unique_ptr<MappedFile>(new MappedFile(address, size));
+    }
+
+    ~MappedFile() {
+        if (address) {
+            ::munmap(address, length);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return static_cast<const char*>(address); }
+    std::size_t size() const { return length; }
+};
 
-        FileNumberReader reader;
-        PrintObserver printObserver;
-        CountObserver countObserver;
-        std::vector<INumberObserver*> observers = { &printObserver, &countObserver };
+template <class T>
+class MmapNumberStream : public BasicNumberStream<T> {
+    std::unique_ptr<MappedFile> file;
+    std::size_t chunk_size;
+    std::vector<T> values;
+    BufferLease<T> values_lease;
+    const char* position;
+    bool failed = false;
+    PipelineStats* stats = nullptr;
 
-        NumberProcessor processor(reader, *filter, observers);
-        processor.run(filename);
+public:
+    MmapNumberStream(std::unique_ptr<MappedFile> f, std::size_t chunk_size, StreamBuffers<T>* buffers = nullptr)
+        : file(std::move(f)), chunk_size(chunk_size), values_lease(value_pool(buffers), values),
+          position(file->data()) {
+        if (chunk_size == 0) {
+            throw std::invalid_argument("Chunk size must be positive");
+        }
+        values.clear();
+        values.reserve(chunk_size);
+    }
 
+    void collect_stats(PipelineStats* s) override {
+        stats = s;
+    }
+
+    std::span<const T> next_chunk() override {
+        values.clear();
+        if (!failed) {
+            const char* start = position;
+            position = parse_numbers(position, file->data() + file->size(), values, chunk_size, failed);
+            if (stats) {
+                stats->bytes_read += static_cast<std::uint64_t>(position - start);
+            }
+        }
+        return values;
+    }
+};
+
+template <class T>
+class MmapNumberReader final : public BasicNumberReader<T> {
+    FileNumberReader<T> fallback;
+    StreamBuffers<T> buffers;
+
+public:
+    std::unique_ptr<BasicNumberStream<T>> open_stream(const std::string& filename, std::size_t chunk_size) override {
+        auto file = MappedFile::open(filename);
+        if (!file) {
+            return fallback.open_stream(filename, chunk_size);
+        }
+        return std::make_unique<MmapNumberStream<T>>(std::move(file), chunk_size, &buffers);
+    }
+};
+
+// ===== Бінарний формат =====
+
+// Файл: BinaryFileHeader, далі блоки. Блок — BinaryBlockHeader зі статистикою
+// (min, max, кількість парних) і payload, доповнений до кратного 4 байтам,
+// тож кожен заголовок і сирі int32 вирівняні.
+// Порядок байтів — рідний для машини (файли не переносяться між архітектурами).
+//   RAW   — count значень int32 як є; читач віддає їх прямо з відображення.
+//   DELTA — zigzag-varint різниць сусідніх значень (перша — від 0).
+constexpr char kBinaryMagic[8] = { 'N', 'P', 'I', 'P', 'E', 'B', 'I', 'N' };
+constexpr std::uint32_t kBinaryVersion = 2;
+constexpr std::uint32_t kBinaryBlockValues = 4096;
+
+enum class BlockEncoding : std::uint8_t { RAW = 0, DELTA = 1 };
+
+struct BinaryFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t block_values;
+    std::uint64_t value_count;
+};
+
+struct BinaryBlockHeader {
+    BlockEncoding encoding;
+    std::uint8_t reserved[3];
+    std::uint32_t count;
+    std::uint32_t payload_bytes;
+    std::int32_t min;
+    std::int32_t max;
+    std::uint32_t even_count;
+};
+
+static_assert(sizeof(BinaryFileHeader) == 24 && sizeof(BinaryBlockHeader) == 24);
+
+inline std::size_t padded_payload(std::size_t bytes) {
+    return (bytes + 3) & ~std::size_t(3);
+}
+
+inline bool is_binary_file(const char* data, std::size_t size) {
+    return size >= sizeof(BinaryFileHeader) && std::memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) == 0;
+}
+
+inline const BinaryFileHeader& binary_header(const MappedFile& file, const std::string& filename) {
+    if (!is_binary_file(file.data(), file.size())) {
+        throw std::runtime_error("Not a binary number file: " + filename);
+    }
+    const auto& header = *reinterpret_cast<const BinaryFileHeader*>(file.data());
+    if (header.version != kBinaryVersion) {
+        throw std::runtime_error("Unsupported binary format version in " + filename + " (convert it again)");
+    }
+    return header;
+}
+
+struct BinaryBlock {
+    const BinaryBlockHeader* header = nullptr;
+    const char* payload = nullptr;
+};
+
+// Перевіряє блок, що починається з p, і повертає адресу наступного. Кількість
+// значень DELTA-блоку обмежена і заголовком файлу, і розміром даних (кожен
+// varint займає хоча б байт), тож пошкоджений заголовок не змусить виділити
+// більше пам'яті, ніж займає сам блок.
+inline const char* next_block(const char* p, const char* end, const BinaryFileHeader& file, BinaryBlock& block) {
+    if (end - p < static_cast<std::ptrdiff_t>(sizeof(BinaryBlockHeader))) {
+        throw std::runtime_error("Corrupted binary file: truncated block header");
+    }
+    block.header = reinterpret_cast<const BinaryBlockHeader*>(p);
+    block.payload = p + sizeof(BinaryBlockHeader);
+
+    std::size_t stored = padded_payload(block.header->payload_bytes);
+    bool valid = static_cast<std::size_t>(end - block.payload) >= stored &&
+                 (block.header->encoding == BlockEncoding::DELTA ||
+                  (block.header->encoding == BlockEncoding::RAW &&
+                   block.header->payload_bytes == std::size_t(block.header->count) * sizeof(int))) &&
+                 block.header->count <= file.block_values &&
+                 (block.header->encoding == BlockEncoding::RAW || block.header->count <= block.header->payload_bytes) &&
+                 block.header->even_count <= block.header->count && block.header->min <= block.header->max;
+    if (!valid) {
+        throw std::runtime_error("Corrupted binary file: bad block");
+    }
+    return block.payload + stored;
+}
+
+inline std::uint32_t zigzag(std::int64_t delta) {
+    return static_cast<std::uint32_t>((static_cast<std::uint64_t>(delta) << 1) ^ static_cast<std::uint64_t>(delta >> 63));
+}
+
+inline std::size_t encode_delta(std::span<const int> values, std::vector<char>& out) {
+    out.resize(values.size() * 5);
+    char* p = out.data();
+    int previous = 0;
+    for (int value : values) {
+        // Різниця int32 мінус int32 вміщується в 33 біти, але за модулем 2^32
+        // відновлюється однозначно, тож достатньо u32 (до 5 байтів varint).
+        std::uint32_t z = zigzag(static_cast<std::int32_t>(static_cast<std::uint32_t>(value) -
+                                                           static_cast<std::uint32_t>(previous)));
+        while (z >= 0x80) {
+            *p++ = static_cast<char>(z | 0x80);
+            z >>= 7;
+        }
+        *p++ = static_cast<char>(z);
+        previous = value;
+    }
+    return static_cast<std::size_t>(p - out.data());
+}
+
+inline void decode_delta(const BinaryBlock& block, std::vector<int>& out) {
+    out.resize(block.header->count);
+    auto p = reinterpret_cast<const unsigned char*>(block.payload);
+    auto end = p + block.header->payload_bytes;
+    std::uint32_t previous = 0;
+    for (auto& value : out) {
+        std::uint32_t z = 0;
+        for (int shift = 0;; shift += 7) {
+            if (p == end || shift > 28) {
+                throw std::runtime_error("Corrupted binary file: bad varint");
+            }
+            std::uint32_t byte = *p++;
+            z |= (byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                break;
+            }
+        }
+        previous += (z >> 1) ^ (0u - (z & 1));
+        value = static_cast<int>(previous);
+    }
+    if (p != end) {
+        throw std::runtime_error("Corrupted binary file: bad block");
+    }
+}
+
+inline BlockStats block_stats(const BinaryBlock& block) {
+    return { block.header->min, block.header->max, block.header->count, block.header->even_count };
+}
+
+// Значення блоку: RAW — без копіювання з відображеного файлу, DELTA —
+// розпаковується в scratch.
+inline std::span<const int> block_values(const BinaryBlock& block, std::vector<int>& scratch) {
+    if (block.header->encoding == BlockEncoding::RAW) {
+        return { reinterpret_cast<const int*>(block.payload), block.header->count };
+    }
+    decode_delta(block, scratch);
+    return scratch;
+}
+
+class BinaryNumberStream : public INumberStream {
+    std::unique_ptr<MappedFile> file;
+    std::size_t chunk_size;
+    const BinaryFileHeader* header;
+    const char* position;
+    std::vector<int> scratch;
+    BufferLease<int> scratch_lease;
+    std::span<const int> current;
+
+public:
+    BinaryNumberStream(std::unique_ptr<MappedFile> f, const std::string& filename, std::size_t chunk_size,
+                       StreamBuffers<int>* buffers = nullptr)
+        : file(std::move(f)), chunk_size(chunk_size), scratch_lease(value_pool(buffers), scratch) {
+        if (chunk_size == 0) {
+            throw std::invalid_argument("Chunk size must be positive");
+        }
+        header = &binary_header(*file, filename);
+        position = file->data() + sizeof(BinaryFileHeader);
+    }
+
+    std::span<const int> next_chunk() override {
+        const char* end = file->data() + file->size();
+        while (current.empty() && position != end) {
+            BinaryBlock block;
+            position = next_block(position, end, *header, block);
+            current = block_values(block, scratch);
+        }
+
+        std::size_t n = std::min(chunk_size, current.size());
+        auto chunk = current.first(n);
+        current = current.subspan(n);
+        return chunk;
+    }
+};
+
+// Читач файлів, записаних BinaryWriterObserver (--convert). Текст не
+// розбирається: RAW-блоки передаються фільтру прямо з відображення.
+class BinaryNumberReader final : public INumberReader {
+    StreamBuffers<int> buffers;
+
+public:
+    std::unique_ptr<INumberStream> open_stream(const std::string& filename, std::size_t chunk_size) override {
+        auto file = MappedFile::open(filename);
+        if (!file) {
+            throw std::runtime_error("Binary input must be a regular file: " + filename);
+        }
+        return std::make_unique<BinaryNumberStream>(std::move(file), filename, chunk_size, &buffers);
+    }
+};
+
+// ===== SIMD-ядра фільтрів =====
+
+// Предикат lo <= x <= hi, де межі залежать від парності x. Ним виражаються
+// EVEN, ODD і GT; порожній діапазон задається як lo > hi.
+template <class T>
+struct ParityRange {
+    T even_lo;
+    T even_hi;
+    T odd_lo;
+    T odd_hi;
+
+    bool contains(T x) const {
+        return (x & 1) ? (odd_lo <= x && x <= odd_hi) : (even_lo <= x && x <= even_hi);
+    }
+};
+
+template <class T>
+using SelectKernel = std::size_t (*)(const T*, std::size_t, T*, const ParityRange<T>&);
+
+template <class T>
+inline std::size_t select_scalar(const T* in, std::size_t n, T* out, const ParityRange<T>& r) {
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        out[kept] = in[i];
+        kept += r.contains(in[i]);
+    }
+    return kept;
+}
+
+#if defined(__x86_64__)
+
+// Для кожної 8-бітної маски — індекси лан, які треба зсунути на початок вектора.
+constexpr auto kCompactTable = [] {
+    std::array<std::array<std::uint32_t, 8>, 256> table{};
+    for (unsigned mask = 0; mask < 256; ++mask) {
+        unsigned k = 0;
+        for (unsigned lane = 0; lane < 8; ++lane) {
+            if (mask & (1u << lane)) {
+                table[mask][k++] = lane;
+            }
+        }
+    }
+    return table;
+}();
+
+// Те саме для чотирьох лан int64: кожна лана — пара 32-бітних індексів.
+constexpr auto kCompactTable64 = [] {
+    std::array<std::array<std::uint32_t, 8>, 16> table{};
+    for (unsigned mask = 0; mask < 16; ++mask) {
+        unsigned k = 0;
+        for (unsigned lane = 0; lane < 4; ++lane) {
+            if (mask & (1u << lane)) {
+                table[mask][k++] = 2 * lane;
+                table[mask][k++] = 2 * lane + 1;
+            }
+        }
+    }
+    return table;
+}();
+
+__attribute__((target("avx2")))
+inline std::size_t select_avx2(const int* in, std::size_t n, int* out, const ParityRange<int>& r) {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i even_lo = _mm256_set1_epi32(r.even_lo);
+    const __m256i even_hi = _mm256_set1_epi32(r.even_hi);
+    const __m256i odd_lo = _mm256_set1_epi32(r.odd_lo);
+    const __m256i odd_hi = _mm256_set1_epi32(r.odd_hi);
+
+    std::size_t kept = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i odd = _mm256_cmpeq_epi32(_mm256_and_si256(x, one), one);
+        __m256i lo = _mm256_blendv_epi8(even_lo, odd_lo, odd);
+        __m256i hi = _mm256_blendv_epi8(even_hi, odd_hi, odd);
+        __m256i reject = _mm256_or_si256(_mm256_cmpgt_epi32(lo, x), _mm256_cmpgt_epi32(x, hi));
+
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(reject))) & 0xFF;
+        __m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kCompactTable[mask].data()));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + kept), _mm256_permutevar8x32_epi32(x, perm));
+        kept += static_cast<std::size_t>(std::popcount(mask));
+    }
+
+    return kept + select_scalar(in + i, n - i, out + kept, r);
+}
+
+inline std::size_t select_sse2(const int* in, std::size_t n, int* out, const ParityRange<int>& r) {
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i even_lo = _mm_set1_epi32(r.even_lo);
+    const __m128i even_hi = _mm_set1_epi32(r.even_hi);
+    const __m128i odd_lo = _mm_set1_epi32(r.odd_lo);
+    const __m128i odd_hi = _mm_set1_epi32(r.odd_hi);
+
+    std::size_t kept = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i odd = _mm_cmpeq_epi32(_mm_and_si128(x, one), one);
+        __m128i lo = _mm_or_si128(_mm_and_si128(odd, odd_lo), _mm_andnot_si128(odd, even_lo));
+        __m128i hi = _mm_or_si128(_mm_and_si128(odd, odd_hi), _mm_andnot_si128(odd, even_hi));
+        __m128i reject = _mm_or_si128(_mm_cmpgt_epi32(lo, x), _mm_cmpgt_epi32(x, hi));
+
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(reject))) & 0xF;
+        for (unsigned lane = 0; lane < 4; ++lane) {
+            out[kept] = in[i + lane];
+            kept += (mask >> lane) & 1;
+        }
+    }
+
+    return kept + select_scalar(in + i, n - i, out + kept, r);
+}
+
+// int64: порівняння 64-бітних лан (vpcmpgtq) є лише з SSE4.2/AVX2, тож без
+// них лишається скалярне ядро.
+__attribute__((target("avx2")))
+inline std::size_t select_avx2(const std::int64_t* in, std::size_t n, std::int64_t* out,
+                               const ParityRange<std::int64_t>& r) {
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i even_lo = _mm256_set1_epi64x(r.even_lo);
+    const __m256i even_hi = _mm256_set1_epi64x(r.even_hi);
+    const __m256i odd_lo = _mm256_set1_epi64x(r.odd_lo);
+    const __m256i odd_hi = _mm256_set1_epi64x(r.odd_hi);
+
+    std::size_t kept = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i odd = _mm256_cmpeq_epi64(_mm256_and_si256(x, one), one);
+        __m256i lo = _mm256_blendv_epi8(even_lo, odd_lo, odd);
+        __m256i hi = _mm256_blendv_epi8(even_hi, odd_hi, odd);
+        __m256i reject = _mm256_or_si256(_mm256_cmpgt_epi64(lo, x), _mm256_cmpgt_epi64(x, hi));
+
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(reject))) & 0xF;
+        __m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kCompactTable64[mask].data()));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + kept), _mm256_permutevar8x32_epi32(x, perm));
+        kept += static_cast<std::size_t>(std::popcount(mask));
+    }
+
+    return kept + select_scalar(in + i, n - i, out + kept, r);
+}
+
+__attribute__((target("sse4.2")))
+inline std::size_t select_sse42(const std::int64_t* in, std::size_t n, std::int64_t* out,
+                                const ParityRange<std::int64_t>& r) {
+    const __m128i one = _mm_set1_epi64x(1);
+    const __m128i even_lo = _mm_set1_epi64x(r.even_lo);
+    const __m128i even_hi = _mm_set1_epi64x(r.even_hi);
+    const __m128i odd_lo = _mm_set1_epi64x(r.odd_lo);
+    const __m128i odd_hi = _mm_set1_epi64x(r.odd_hi);
+
+    std::size_t kept = 0;
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i odd = _mm_cmpeq_epi64(_mm_and_si128(x, one), one);
+        __m128i lo = _mm_blendv_epi8(even_lo, odd_lo, odd);
+        __m128i hi = _mm_blendv_epi8(even_hi, odd_hi, odd);
+        __m128i reject = _mm_or_si128(_mm_cmpgt_epi64(lo, x), _mm_cmpgt_epi64(x, hi));
+
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(reject))) & 0x3;
+        out[kept] = in[i];
+        kept += mask & 1;
+        out[kept] = in[i + 1];
+        kept += mask >> 1;
+    }
+
+    return kept + select_scalar(in + i, n - i, out + kept, r);
+}
+
+template <class T>
+inline SelectKernel<T> pick_select_kernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return select_avx2;
+    }
+    if constexpr (std::is_same_v<T, int>) {
+        return select_sse2;
+    } else {
+        return __builtin_cpu_supports("sse4.2") ? select_sse42 : select_scalar<T>;
+    }
+}
+
+#elif defined(__ARM_NEON)
+
+inline std::size_t select_neon(const int* in, std::size_t n, int* out, const ParityRange<int>& r) {
+    const int32x4_t one = vdupq_n_s32(1);
+    const int32x4_t even_lo = vdupq_n_s32(r.even_lo);
+    const int32x4_t even_hi = vdupq_n_s32(r.even_hi);
+    const int32x4_t odd_lo = vdupq_n_s32(r.odd_lo);
+    const int32x4_t odd_hi = vdupq_n_s32(r.odd_hi);
+
+    std::size_t kept = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t x = vld1q_s32(in + i);
+        uint32x4_t odd = vceqq_s32(vandq_s32(x, one), one);
+        int32x4_t lo = vbslq_s32(odd, odd_lo, even_lo);
+        int32x4_t hi = vbslq_s32(odd, odd_hi, even_hi);
+        uint32x4_t accept = vandq_u32(vcgeq_s32(x, lo), vcleq_s32(x, hi));
+
+        std::uint32_t lanes[4];
+        vst1q_u32(lanes, accept);
+        for (unsigned lane = 0; lane < 4; ++lane) {
+            out[kept] = in[i + lane];
+            kept += lanes[lane] & 1;
+        }
+    }
+
+    return kept + select_scalar(in + i, n - i, out + kept, r);
+}
+
+#if defined(__aarch64__)
+// 64-бітні порівняння NEON є лише в AArch64.
+inline std::size_t select_neon(const std::int64_t* in, std::size_t n, std::int64_t* out,
+                               const ParityRange<std::int64_t>& r) {
+    const int64x2_t one = vdupq_n_s64(1);
+    const int64x2_t even_lo = vdupq_n_s64(r.even_lo);
+    const int64x2_t even_hi = vdupq_n_s64(r.even_hi);
+    const int64x2_t odd_lo = vdupq_n_s64(r.odd_lo);
+    const int64x2_t odd_hi = vdupq_n_s64(r.odd_hi);
+
+    std::size_t kept = 0;
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        int64x2_t x = vld1q_s64(in + i);
+        uint64x2_t odd = vceqq_s64(vandq_s64(x, one), one);
+        int64x2_t lo = vbslq_s64(odd, odd_lo, even_lo);
+        int64x2_t hi = vbslq_s64(odd, odd_hi, even_hi);
+        uint64x2_t accept = vandq_u64(vcgeq_s64(x, lo), vcleq_s64(x, hi));
+
+        out[kept] = in[i];
+        kept += vgetq_lane_u64(accept, 0) & 1;
+        out[kept] = in[i + 1];
+        kept += vgetq_lane_u64(accept, 1) & 1;
+    }
+
+    return kept + select_scalar(in + i, n - i, out + kept, r);
+}
+#endif
+
+template <class T>
+inline SelectKernel<T> pick_select_kernel() {
+#if defined(__aarch64__)
+    return select_neon;
+#else
+    if constexpr (std::is_same_v<T, int>) {
+        return select_neon;
+    } else {
+        return select_scalar<T>;
+    }
+#endif
+}
+
+#else
+
+template <class T>
+inline SelectKernel<T> pick_select_kernel() {
+    return select_scalar<T>;
+}
+
+#endif
+
+template <class T>
+inline std::size_t select_parity_range(std::span<const T> input, T* out, const ParityRange<T>& range) {
+    static const SelectKernel<T> kernel = pick_select_kernel<T>();
+    return kernel(input.data(), input.size(), out, range);
+}
+
+// ===== Реалізації фільтрів =====
+
+template <class T>
+class EvenFilter final : public BasicNumberFilter<T> {
+    static constexpr T kMin = std::numeric_limits<T>::min();
+    static constexpr T kMax = std::numeric_limits<T>::max();
+
+public:
+    bool keep(T number) const override {
+        return number % 2 == 0;
+    }
+
+    std::size_t keep_batch(std::span<const T> input, T* out) const override {
+        return select_parity_range(input, out, {kMin, kMax, kMax, kMin});
+    }
+
+    BlockMatch classify_block(const BlockStats& stats) const override {
+        if (stats.even_count == 0) {
+            return BlockMatch::NONE;
+        }
+        return stats.even_count == stats.count ? BlockMatch::ALL : BlockMatch::MIXED;
+    }
+};
+
+template <class T>
+class OddFilter final : public BasicNumberFilter<T> {
+    static constexpr T kMin = std::numeric_limits<T>::min();
+    static constexpr T kMax = std::numeric_limits<T>::max();
+
+public:
+    bool keep(T number) const override {
+        return number % 2 != 0;
+    }
+
+    std::size_t keep_batch(std::span<const T> input, T* out) const override {
+        return select_parity_range(input, out, {kMax, kMin, kMin, kMax});
+    }
+
+    BlockMatch classify_block(const BlockStats& stats) const override {
+        if (stats.even_count == stats.count) {
+            return BlockMatch::NONE;
+        }
+        return stats.even_count == 0 ? BlockMatch::ALL : BlockMatch::MIXED;
+    }
+};
+
+template <class T>
+class GreaterThanFilter final : public BasicNumberFilter<T> {
+    static constexpr T kMax = std::numeric_limits<T>::max();
+
+    T threshold;
+public:
+    explicit GreaterThanFilter(T t) : threshold(t) {}
+
+    bool keep(T number) const override {
+        return number > threshold;
+    }
+
+    std::size_t keep_batch(std::span<const T> input, T* out) const override {
+        if (threshold == kMax) {
+            return 0;
+        }
+        return select_parity_range(input, out, {threshold + 1, kMax, threshold + 1, kMax});
+    }
+
+    BlockMatch classify_block(const BlockStats& stats) const override {
+        if (stats.max <= threshold) {
+            return BlockMatch::NONE;
+        }
+        return stats.min > threshold ? BlockMatch::ALL : BlockMatch::MIXED;
+    }
+};
+
+// ===== Обсервери =====
+
+// Найдовший десятковий запис значення типу T разом зі знаком.
+template <class T>
+constexpr std::size_t kMaxDigits = std::numeric_limits<T>::digits10 + 2;
+
+template <class T>
+class BasicPrintObserver final : public BasicNumberObserver<T> {
+    std::string text;
+
+public:
+    void on_number(T number) override {
+        std::cout << number << std::endl;
+    }
+
+    // Увесь блок форматується в один рядок і виводиться одним записом.
+    void on_batch(std::span<const T> numbers) override {
+        text.resize(numbers.size() * (kMaxDigits<T> + 1));
+        char* out = text.data();
+        for (T number : numbers) {
+            out = std::to_chars(out, out + kMaxDigits<T>, number).ptr;
+            *out++ = '\n';
+        }
+        std::cout.write(text.data(), out - text.data());
+        std::cout.flush();
+    }
+
+    void on_finished() override {}
+};
+
+using PrintObserver = BasicPrintObserver<int>;
+
+inline void write_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Write error: ") + std::strerror(errno));
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+// Друкує значення у великий буфер і скидає його одним write() у дескриптор,
+// коли буфер заповнено, та в on_finished().
+template <class T>
+class BasicBufferedPrintObserver final : public BasicNumberObserver<T> {
+    static constexpr std::size_t kMaxLine = kMaxDigits<T> + 1;
+
+    int fd;
+    std::vector<char> buffer;
+    std::size_t used = 0;
+
+    void flush() {
+        if (used > 0) {
+            write_all(fd, buffer.data(), used);
+            used = 0;
+        }
+    }
+
+    void append(T number) {
+        char* out = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), number).ptr;
+        *out++ = '\n';
+        used = static_cast<std::size_t>(out - buffer.data());
+    }
+
+public:
+    explicit BasicBufferedPrintObserver(int output_fd = STDOUT_FILENO, std::size_t buffer_size = 1 << 20)
+        : fd(output_fd), buffer(std::max(buffer_size, kMaxLine)) {
+        // Усе, що вже лежить у буфері std::cout, має потрапити у вивід раніше.
+        std::cout.flush();
+    }
+
+    ~BasicBufferedPrintObserver() override {
+        try {
+            flush();
+        } catch (const std::exception&) {
+        }
+    }
+
+    void on_number(T number) override {
+        if (buffer.size() - used < kMaxLine) {
+            flush();
+        }
+        append(number);
+    }
+
+    void on_batch(std::span<const T> numbers) override {
+        for (T number : numbers) {
+            if (buffer.size() - used < kMaxLine) {
+                flush();
+            }
+            append(number);
+        }
+    }
+
+    void on_finished() override {
+        flush();
+    }
+};
+
+using BufferedPrintObserver = BasicBufferedPrintObserver<int>;
+
+template <class T>
+class BasicCountObserver final : public BasicMergeableObserver<T> {
+    std::size_t count = 0;
+    std::string label;
+public:
+    // Непорожня мітка (вираз фільтра) розрізняє підсумки кількох запитів.
+    explicit BasicCountObserver(std::string l = {}) : label(std::move(l)) {}
+
+    void on_number(T) override {
+        ++count;
+    }
+
+    void on_batch(std::span<const T> numbers) override {
+        count += numbers.size();
+    }
+
+    bool needs_values() const override {
+        return false;
+    }
+
+    void on_count(std::size_t n) override {
+        count += n;
+    }
+
+    void on_finished() override {
+        if (label.empty()) {
+            std::cout << "Total numbers passed filter: " << count << std::endl;
+        } else {
+            std::cout << "Total numbers passed filter " << label << ": " << count << std::endl;
+        }
+    }
+
+    std::unique_ptr<BasicMergeableObserver<T>> make_partial() const override {
+        return std::make_unique<BasicCountObserver>(label);
+    }
+
+    void merge(const BasicMergeableObserver<T>& partial) override {
+        count += static_cast<const BasicCountObserver&>(partial).count;
+    }
+};
+
+using CountObserver = BasicCountObserver<int>;
+
+// Записує отримані значення у бінарний формат блоками по block_values.
+// З DELTA блок кодується різницями, лише якщо так він менший за RAW.
+class BinaryWriterObserver final : public INumberObserver {
+    FileDescriptor fd;
+    BlockEncoding encoding;
+    std::size_t block_values;
+    std::vector<int> pending;
+    std::vector<char> encoded;
+    std::vector<char> buffer;
+    std::uint64_t total = 0;
+
+    void flush_buffer() {
+        write_all(fd.get(), buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    void write_block() {
+        if (pending.empty()) {
+            return;
+        }
+
+        BinaryBlockHeader header{};
+        header.encoding = BlockEncoding::RAW;
+        header.count = static_cast<std::uint32_t>(pending.size());
+        auto [min, max] = std::minmax_element(pending.begin(), pending.end());
+        header.min = *min;
+        header.max = *max;
+        header.even_count = static_cast<std::uint32_t>(
+            std::count_if(pending.begin(), pending.end(), [](int v) { return v % 2 == 0; }));
+        const char* payload = reinterpret_cast<const char*>(pending.data());
+        std::size_t bytes = pending.size() * sizeof(int);
+        if (encoding == BlockEncoding::DELTA) {
+            std::size_t delta_bytes = encode_delta(pending, encoded);
+            if (delta_bytes < bytes) {
+                header.encoding = BlockEncoding::DELTA;
+                payload = encoded.data();
+                bytes = delta_bytes;
+            }
+        }
+        header.payload_bytes = static_cast<std::uint32_t>(bytes);
+
+        const char* raw_header = reinterpret_cast<const char*>(&header);
+        buffer.insert(buffer.end(), raw_header, raw_header + sizeof(header));
+        buffer.insert(buffer.end(), payload, payload + bytes);
+        buffer.resize(buffer.size() + padded_payload(bytes) - bytes, 0);
+        total += pending.size();
+        pending.clear();
+
+        if (buffer.size() >= (1 << 20)) {
+            flush_buffer();
+        }
+    }
+
+public:
+    BinaryWriterObserver(const std::string& filename, BlockEncoding e, std::size_t values = kBinaryBlockValues)
+        : fd(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)), encoding(e), block_values(values) {
+        if (fd.get() < 0) {
+            throw std::runtime_error("Cannot create file: " + filename);
+        }
+        if (block_values == 0 || block_values > UINT32_MAX / sizeof(int)) {
+            throw std::invalid_argument("Invalid block size");
+        }
+        pending.reserve(block_values);
+        BinaryFileHeader header{};
+        std::memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+        header.version = kBinaryVersion;
+        header.block_values = static_cast<std::uint32_t>(block_values);
+        const char* raw_header = reinterpret_cast<const char*>(&header);
+        buffer.assign(raw_header, raw_header + sizeof(header));
+    }
+
+    void on_number(int number) override {
+        pending.push_back(number);
+        if (pending.size() == block_values) {
+            write_block();
+        }
+    }
+
+    void on_batch(std::span<const int> numbers) override {
+        while (!numbers.empty()) {
+            std::size_t n = std::min(numbers.size(), block_values - pending.size());
+            pending.insert(pending.end(), numbers.begin(), numbers.begin() + n);
+            numbers = numbers.subspan(n);
+            if (pending.size() == block_values) {
+                write_block();
+            }
+        }
+    }
+
+    // Дописує останній блок і кількість значень у заголовок файлу.
+    void on_finished() override {
+        write_block();
+        flush_buffer();
+        if (::pwrite(fd.get(), &total, sizeof(total), offsetof(BinaryFileHeader, value_count)) != sizeof(total)) {
+            throw std::runtime_error(std::string("Write error: ") + std::strerror(errno));
+        }
+    }
+
+    std::uint64_t written() const { return total; }
+};
+
+// ===== Агрегати =====
+
+// Усі агрегати — IMergeableObserver: у паралельному режимі кожен шматок рахує
+// власний частковий стан, а потім стани зливаються. Мітка, як і в
+// CountObserver, розрізняє підсумки кількох запитів.
+inline std::string summary_title(const char* name, const std::string& label) {
+    return label.empty() ? std::string(name) : std::string(name) + " " + label;
+}
+
+// Для __int128 немає operator<<.
+inline std::string wide_to_string(__int128 value) {
+    if (value >= INT64_MIN && value <= INT64_MAX) {
+        return std::to_string(static_cast<std::int64_t>(value));
+    }
+    unsigned __int128 magnitude = value < 0 ? 0 - static_cast<unsigned __int128>(value) : value;
+    std::string text;
+    for (; magnitude != 0; magnitude /= 10) {
+        text.push_back(static_cast<char>('0' + static_cast<int>(magnitude % 10)));
+    }
+    if (value < 0) {
+        text.push_back('-');
+    }
+    std::reverse(text.begin(), text.end());
+    return text;
+}
+
+// Сума int32 — в int64: навіть 2^32 значень не переповнять акумулятор. Для
+// int64 так само береться __int128.
+template <class T>
+class SumObserver final : public BasicMergeableObserver<T> {
+public:
+    using Accumulator = std::conditional_t<(sizeof(T) < sizeof(std::int64_t)), std::int64_t, __int128>;
+
+private:
+    Accumulator sum = 0;
+    std::string label;
+
+public:
+    explicit SumObserver(std::string l = {}) : label(std::move(l)) {}
+
+    void on_number(T number) override {
+        sum += number;
+    }
+
+    void on_batch(std::span<const T> numbers) override {
+        Accumulator local = 0;
+        for (T number : numbers) {
+            local += number;
+        }
+        sum += local;
+    }
+
+    void on_finished() override {
+        std::cout << summary_title("Sum", label) << ": " << wide_to_string(sum) << std::endl;
+    }
+
+    std::unique_ptr<BasicMergeableObserver<T>> make_partial() const override {
+        return std::make_unique<SumObserver>(label);
+    }
+
+    void merge(const BasicMergeableObserver<T>& partial) override {
+        sum += static_cast<const SumObserver&>(partial).sum;
+    }
+
+    Accumulator value() const { return sum; }
+};
+
+template <class T>
+class MinMaxObserver final : public BasicMergeableObserver<T> {
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::min();
+    bool seen = false;
+    std::string label;
+
+public:
+    explicit MinMaxObserver(std::string l = {}) : label(std::move(l)) {}
+
+    void on_number(T number) override {
+        on_batch({&number, 1});
+    }
+
+    void on_batch(std::span<const T> numbers) override {
+        if (numbers.empty()) {
+            return;
+        }
+        T lo = min;
+        T hi = max;
+        for (T number : numbers) {
+            lo = std::min(lo, number);
+            hi = std::max(hi, number);
+        }
+        min = lo;
+        max = hi;
+        seen = true;
+    }
+
+    void on_finished() override {
+        std::cout << summary_title("Min/Max", label) << ": ";
+        if (seen) {
+            std::cout << min << " " << max << std::endl;
+        } else {
+            std::cout << "none" << std::endl;
+        }
+    }
+
+    std::unique_ptr<BasicMergeableObserver<T>> make_partial() const override {
+        return std::make_unique<MinMaxObserver>(label);
+    }
+
+    void merge(const BasicMergeableObserver<T>& partial) override {
+        const auto& other = static_cast<const MinMaxObserver&>(partial);
+        if (other.seen) {
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+            seen = true;
+        }
+    }
+};
+
+// Гістограма з buckets однакових кошиків на [lo, hi]; значення поза
+// діапазоном рахуються окремо як below/above. Зсуви від lo рахуються в u64,
+// тож і весь діапазон int64 не переповнюється.
+template <class T>
+class HistogramObserver final : public BasicMergeableObserver<T> {
+    T lo;
+    T hi;
+    std::vector<std::size_t> counts;
+    // Кошик i починається з lo + edges[i], де edges[i] = i * span / N, тож
+    // кошики ділять [lo, hi] майже порівну і жоден не виходить за hi.
+    std::vector<std::uint64_t> edges;
+    // Наближення 2^64 * N / span: індекс — старші 64 біти offset * scale,
+    // що менший за точний щонайбільше на одиницю.
+    std::uint64_t scale = 0;
+    std::size_t below = 0;
+    std::size_t above = 0;
+    std::string label;
+
+    // До 2^64 значень для повного діапазону int64.
+    unsigned __int128 span() const {
+        return static_cast<unsigned __int128>(static_cast<__int128>(hi) - lo) + 1;
+    }
+
+    __int128 bucket_end(std::size_t i) const {
+        __int128 next = i + 1 < counts.size() ? static_cast<__int128>(edges[i + 1]) : static_cast<__int128>(span());
+        return lo + next - 1;
+    }
+
+public:
+    HistogramObserver(T l, T h, std::size_t buckets, std::string name = {})
+        : lo(l), hi(h), counts(buckets), label(std::move(name)) {
+        if (l > h || buckets == 0) {
+            throw std::invalid_argument("Invalid histogram range");
+        }
+        const unsigned __int128 n = buckets;
+        if (n > span()) {
+            throw std::invalid_argument("Histogram has more buckets than values in its range");
+        }
+        edges.resize(buckets);
+        for (std::size_t i = 0; i < buckets; ++i) {
+            edges[i] = static_cast<std::uint64_t>(i * span() / n);
+        }
+        scale = static_cast<std::uint64_t>(std::min<unsigned __int128>((n << 64) / span(), UINT64_MAX));
+    }
+
+    void on_number(T number) override {
+        on_batch({&number, 1});
+    }
+
+    void on_batch(std::span<const T> numbers) override {
+        const std::size_t last = counts.size() - 1;
+        for (T number : numbers) {
+            if (number < lo) {
+                ++below;
+            } else if (number > hi) {
+                ++above;
+            } else {
+                std::uint64_t offset = static_cast<std::uint64_t>(number) - static_cast<std::uint64_t>(lo);
+                auto index = static_cast<std::size_t>((static_cast<unsigned __int128>(offset) * scale) >> 64);
+                index += index < last && offset >= edges[index + 1];
+                ++counts[index];
+            }
+        }
+    }
+
+    void on_finished() override {
+        std::cout << summary_title("Histogram", label) << ":" << std::endl;
+        if (below > 0) {
+            std::cout << "  < " << lo << ": " << below << std::endl;
+        }
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+            __int128 begin = lo + static_cast<__int128>(edges[i]);
+            __int128 end = bucket_end(i);
+            std::cout << "  [" << wide_to_string(begin) << ", " << wide_to_string(end) << "]: " << counts[i]
+                      << std::endl;
+        }
+        if (above > 0) {
+            std::cout << "  > " << hi << ": " << above << std::endl;
+        }
+    }
+
+    std::unique_ptr<BasicMergeableObserver<T>> make_partial() const override {
+        return std::make_unique<HistogramObserver>(lo, hi, counts.size(), label);
+    }
+
+    void merge(const BasicMergeableObserver<T>& partial) override {
+        const auto& other = static_cast<const HistogramObserver&>(partial);
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+            counts[i] += other.counts[i];
+        }
+        below += other.below;
+        above += other.above;
+    }
+};
+
+// Приблизна кількість різних значень (HyperLogLog, 2^14 регістрів, похибка
+// близько 0.8%). Злиття — поелементний максимум регістрів.
+template <class T>
+class DistinctObserver final : public BasicMergeableObserver<T> {
+    static constexpr int kPrecision = 14;
+    static constexpr std::size_t kRegisters = std::size_t(1) << kPrecision;
+
+    std::vector<std::uint8_t> registers = std::vector<std::uint8_t>(kRegisters);
+    std::string label;
+
+    static std::uint64_t hash(T number) {
+        std::uint64_t x = static_cast<std::make_unsigned_t<T>>(number);
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    void add(T number) {
+        std::uint64_t h = hash(number);
+        std::size_t index = static_cast<std::size_t>(h >> (64 - kPrecision));
+        std::uint64_t rest = (h << kPrecision) | (std::uint64_t(1) << (kPrecision - 1));
+        auto rank = static_cast<std::uint8_t>(std::countl_zero(rest) + 1);
+        registers[index] = std::max(registers[index], rank);
+    }
+
+public:
+    explicit DistinctObserver(std::string l = {}) : label(std::move(l)) {}
+
+    void on_number(T number) override {
+        add(number);
+    }
+
+    void on_batch(std::span<const T> numbers) override {
+        for (T number : numbers) {
+            add(number);
+        }
+    }
+
+    std::uint64_t estimate() const {
+        const double m = static_cast<double>(kRegisters);
+        double sum = 0;
+        std::size_t zeros = 0;
+        for (std::uint8_t r : registers) {
+            sum += std::ldexp(1.0, -r);
+            zeros += r == 0;
+        }
+        double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+        // Для малих кількостей точніший лінійний підрахунок порожніх регістрів.
+        if (estimate <= 2.5 * m && zeros > 0) {
+            estimate = m * std::log(m / static_cast<double>(zeros));
+        }
+        return static_cast<std::uint64_t>(estimate + 0.5);
+    }
+
+    void on_finished() override {
+        std::cout << summary_title("Distinct (approx.)", label) << ": " << estimate() << std::endl;
+    }
+
+    std::unique_ptr<BasicMergeableObserver<T>> make_partial() const override {
+        return std::make_unique<DistinctObserver>(label);
+    }
+
+    void merge(const BasicMergeableObserver<T>& partial) override {
+        const auto& other = static_cast<const DistinctObserver&>(partial);
+        for (std::size_t i = 0; i < kRegisters; ++i) {
+            registers[i] = std::max(registers[i], other.registers[i]);
+        }
+    }
+};
+
+// k найбільших значень (з повтореннями) у min-купі розміру k: значення, не
+// більше за вершину заповненої купи, відкидається одним порівнянням.
+template <class T>
+class TopKObserver final : public BasicMergeableObserver<T> {
+    std::size_t k;
+    std::vector<T> heap;
+    std::string label;
+
+    void add(T number) {
+        if (heap.size() < k) {
+            heap.push_back(number);
+            std::push_heap(heap.begin(), heap.end(), std::greater<T>());
+        } else if (number > heap.front()) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<T>());
+            heap.back() = number;
+            std::push_heap(heap.begin(), heap.end(), std::greater<T>());
+        }
+    }
+
+public:
+    explicit TopKObserver(std::size_t count, std::string l = {}) : k(count), label(std::move(l)) {
+        if (k == 0) {
+            throw std::invalid_argument("Top-k size must be positive");
+        }
+        heap.reserve(k);
+    }
+
+    void on_number(T number) override {
+        add(number);
+    }
+
+    void on_batch(std::span<const T> numbers) override {
+        for (T number : numbers) {
+            if (heap.size() == k && number <= heap.front()) {
+                continue;
+            }
+            add(number);
+        }
+    }
+
+    void on_finished() override {
+        std::vector<T> sorted = heap;
+        std::sort(sorted.begin(), sorted.end(), std::greater<T>());
+        std::cout << summary_title("Top", label) << " " << k << ":";
+        for (T number : sorted) {
+            std::cout << " " << number;
+        }
+        std::cout << std::endl;
+    }
+
+    std::unique_ptr<BasicMergeableObserver<T>> make_partial() const override {
+        return std::make_unique<TopKObserver>(k, label);
+    }
+
+    void merge(const BasicMergeableObserver<T>& partial) override {
+        for (T number : static_cast<const TopKObserver&>(partial).heap) {
+            add(number);
+        }
+    }
+};
+
+// ===== Вирази фільтрів =====
+
+// Множина значень типу T як відсортований список неперетинних замкнених
+// інтервалів. Межі зберігаються в ширшому типі (int64 для int, __int128 для
+// int64), щоб n + 1 та n - 1 не переповнювались.
+template <class T>
+class IntervalSet {
+public:
+    using Bound = std::conditional_t<(sizeof(T) < sizeof(std::int64_t)), std::int64_t, __int128>;
+    using Interval = std::pair<Bound, Bound>;
+
+    static constexpr Bound kMin = std::numeric_limits<T>::min();
+    static constexpr Bound kMax = std::numeric_limits<T>::max();
+
+private:
+    std::vector<Interval> parts;
+
+    static IntervalSet merged(std::vector<Interval> items, Bound gap) {
+        std::sort(items.begin(), items.end());
+        IntervalSet result;
+        for (const auto& item : items) {
+            if (!result.parts.empty() && item.first <= result.parts.back().second + gap) {
+                result.parts.back().second = std::max(result.parts.back().second, item.second);
+            } else {
+                result.parts.push_back(item);
+            }
+        }
+        return result;
+    }
+
+public:
+    static IntervalSet none() {
+        return {};
+    }
+
+    static IntervalSet all() {
+        return range(kMin, kMax);
+    }
+
+    static IntervalSet range(Bound lo, Bound hi) {
+        IntervalSet result;
+        lo = std::max(lo, kMin);
+        hi = std::min(hi, kMax);
+        if (lo <= hi) {
+            result.parts.push_back({lo, hi});
+        }
+        return result;
+    }
+
+    IntervalSet complement() const {
+        IntervalSet result;
+        Bound next = kMin;
+        for (const auto& [lo, hi] : parts) {
+            if (lo > next) {
+                result.parts.push_back({next, lo - 1});
+            }
+            next = hi + 1;
+        }
+        if (next <= kMax) {
+            result.parts.push_back({next, kMax});
+        }
+        return result;
+    }
+
+    IntervalSet intersect(const IntervalSet& other) const {
+        IntervalSet result;
+        std::size_t i = 0;
+        std::size_t j = 0;
+        while (i < parts.size() && j < other.parts.size()) {
+            Bound lo = std::max(parts[i].first, other.parts[j].first);
+            Bound hi = std::min(parts[i].second, other.parts[j].second);
+            if (lo <= hi) {
+                result.parts.push_back({lo, hi});
+            }
+            if (parts[i].second < other.parts[j].second) {
+                ++i;
+            } else {
+                ++j;
+            }
+        }
+        return result;
+    }
+
+    IntervalSet unite(const IntervalSet& other) const {
+        std::vector<Interval> items = parts;
+        items.insert(items.end(), other.parts.begin(), other.parts.end());
+        return merged(std::move(items), 1);
+    }
+
+    // Залишає лише числа заданої парності: межі підтягуються до найближчих
+    // чисел цієї парності, а інтервали, між якими нема таких чисел, зливаються.
+    IntervalSet restricted_to_parity(int parity) const {
+        std::vector<Interval> items;
+        for (auto [lo, hi] : parts) {
+            if ((lo & 1) != parity) {
+                ++lo;
+            }
+            if ((hi & 1) != parity) {
+                --hi;
+            }
+            if (lo <= hi) {
+                items.push_back({lo, hi});
+            }
+        }
+        return merged(std::move(items), 2);
+    }
+
+    const std::vector<Interval>& intervals() const {
+        return parts;
+    }
+};
+
+// Результат виразу окремо для парних і непарних чисел: так EVEN/ODD стають
+// звичайними інтервалами, а весь вираз — двома списками інтервалів.
+template <class T>
+struct ParitySet {
+    IntervalSet<T> even;
+    IntervalSet<T> odd;
+
+    ParitySet operator&(const ParitySet& other) const {
+        return {even.intersect(other.even), odd.intersect(other.odd)};
+    }
+    ParitySet operator|(const ParitySet& other) const {
+        return {even.unite(other.even), odd.unite(other.odd)};
+    }
+    ParitySet operator!() const {
+        return {even.complement(), odd.complement()};
+    }
+};
+
+// Скомпільований вираз: одна перевірка інтервалів замість дерева віртуальних
+// викликів. Якщо для кожної парності лишився один інтервал, пакетна обробка
+// йде через SIMD-ядро select_parity_range.
+template <class T>
+class FusedFilter final : public BasicNumberFilter<T> {
+    std::vector<std::pair<T, T>> even;
+    std::vector<std::pair<T, T>> odd;
+    ParityRange<T> range{};
+    bool single_range = false;
+
+    static std::vector<std::pair<T, T>> to_values(const IntervalSet<T>& set, int parity) {
+        std::vector<std::pair<T, T>> result;
+        IntervalSet<T> restricted = set.restricted_to_parity(parity);
+        for (const auto& [lo, hi] : restricted.intervals()) {
+            result.push_back({static_cast<T>(lo), static_cast<T>(hi)});
+        }
+        return result;
+    }
+
+    static bool contains(const std::vector<std::pair<T, T>>& parts, T number) {
+        auto it = std::lower_bound(parts.begin(), parts.end(), number,
+                                   [](const std::pair<T, T>& part, T x) { return part.second < x; });
+        return it != parts.end() && it->first <= number;
+    }
+
+    // Як інтервали однієї парності співвідносяться з [min, max]: перший
+    // інтервал, що закінчується не раніше min, або цілком його покриває, або
+    // лише перетинає, або лежить правіше (тоді перетину немає).
+    static BlockMatch classify(const std::vector<std::pair<T, T>>& parts, T min, T max) {
+        auto it = std::lower_bound(parts.begin(), parts.end(), min,
+                                   [](const std::pair<T, T>& part, T x) { return part.second < x; });
+        if (it == parts.end() || it->first > max) {
+            return BlockMatch::NONE;
+        }
+        return it->first <= min && it->second >= max ? BlockMatch::ALL : BlockMatch::MIXED;
+    }
+
+public:
+    explicit FusedFilter(const ParitySet<T>& set) : even(to_values(set.even, 0)), odd(to_values(set.odd, 1)) {
+        if (even.size() <= 1 && odd.size() <= 1) {
+            constexpr T kMin = std::numeric_limits<T>::min();
+            constexpr T kMax = std::numeric_limits<T>::max();
+            single_range = true;
+            range = {kMax, kMin, kMax, kMin};
+            if (!even.empty()) {
+                range.even_lo = even[0].first;
+                range.even_hi = even[0].second;
+            }
+            if (!odd.empty()) {
+                range.odd_lo = odd[0].first;
+                range.odd_hi = odd[0].second;
+            }
+        }
+    }
+
+    bool keep(T number) const override {
+        return contains((number & 1) ? odd : even, number);
+    }
+
+    std::size_t keep_batch(std::span<const T> input, T* out) const override {
+        if (single_range) {
+            return select_parity_range(input, out, range);
+        }
+
+        std::size_t kept = 0;
+        for (T number : input) {
+            out[kept] = number;
+            kept += contains((number & 1) ? odd : even, number);
+        }
+        return kept;
+    }
+
+    // Враховуються лише парності, значення яких є в блоці.
+    BlockMatch classify_block(const BlockStats& stats) const override {
+        BlockMatch even_match = stats.even_count > 0 ? classify(even, stats.min, stats.max) : BlockMatch::NONE;
+        BlockMatch odd_match = stats.even_count < stats.count ? classify(odd, stats.min, stats.max) : BlockMatch::NONE;
+        if (stats.even_count == 0) {
+            return odd_match;
+        }
+        if (stats.even_count == stats.count) {
+            return even_match;
+        }
+        return even_match == odd_match ? even_match : BlockMatch::MIXED;
+    }
+};
+
+// Граматика:
+//   expr   := term ('|' term)*
+//   term   := factor ('&' factor)*
+//   factor := '!' factor | '(' expr ')' | atom
+//   atom   := EVEN | ODD | GT<n> | GE<n> | LT<n> | LE<n> | EQ<n> | <a>..<b>
+// Числа n, a, b мають вміщатися в T.
+template <class T>
+class FilterExpressionParser {
+    using Set = IntervalSet<T>;
+    using Bound = typename Set::Bound;
+
+    const std::string& input;
+    std::size_t pos = 0;
+
+    [[noreturn]] void fail(const std::string& reason) const {
+        throw std::invalid_argument("Invalid filter expression '" + input + "': " + reason +
+                                    " at position " + std::to_string(pos));
+    }
+
+    bool consume(char c) {
+        if (pos < input.size() && input[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    Bound number() {
+        T value = 0;
+        const char* begin = input.data() + pos;
+        const char* end = input.data() + input.size();
+        if (begin != end && *begin == '+') {
+            ++begin;
+        }
+        auto [next, ec] = std::from_chars(begin, end, value);
+        if (ec == std::errc::result_out_of_range) {
+            fail("number out of range");
+        }
+        if (ec != std::errc()) {
+            fail("expected number");
+        }
+        pos = static_cast<std::size_t>(next - input.data());
+        return value;
+    }
+
+    ParitySet<T> atom() {
+        std::size_t start = pos;
+        while (pos < input.size() && std::isupper(static_cast<unsigned char>(input[pos]))) {
+            ++pos;
+        }
+        std::string name = input.substr(start, pos - start);
+
+        if (name.empty()) {
+            Bound lo = number();
+            if (!consume('.') || !consume('.')) {
+                fail("expected '..'");
+            }
+            Bound hi = number();
+            return both(Set::range(lo, hi));
+        }
+        if (name == "EVEN") {
+            return {Set::all(), Set::none()};
+        }
+        if (name == "ODD") {
+            return {Set::none(), Set::all()};
+        }
+        if (name == "GT") {
+            return both(Set::range(number() + 1, Set::kMax));
+        }
+        if (name == "GE") {
+            return both(Set::range(number(), Set::kMax));
+        }
+        if (name == "LT") {
+            return both(Set::range(Set::kMin, number() - 1));
+        }
+        if (name == "LE") {
+            return both(Set::range(Set::kMin, number()));
+        }
+        if (name == "EQ") {
+            Bound value = number();
+            return both(Set::range(value, value));
+        }
+
+        throw std::invalid_argument("Unknown filter: " + name);
+    }
+
+    static ParitySet<T> both(const Set& set) {
+        return {set, set};
+    }
+
+    ParitySet<T> factor() {
+        if (consume('!')) {
+            return !factor();
+        }
+        if (consume('(')) {
+            ParitySet<T> result = expr();
+            if (!consume(')')) {
+                fail("expected ')'");
+            }
+            return result;
+        }
+        return atom();
+    }
+
+    ParitySet<T> term() {
+        ParitySet<T> result = factor();
+        while (consume('&')) {
+            result = result & factor();
+        }
+        return result;
+    }
+
+    ParitySet<T> expr() {
+        ParitySet<T> result = term();
+        while (consume('|')) {
+            result = result | term();
+        }
+        return result;
+    }
+
+public:
+    explicit FilterExpressionParser(const std::string& text) : input(text) {}
+
+    ParitySet<T> parse() {
+        ParitySet<T> result = expr();
+        if (pos != input.size()) {
+            fail("unexpected character");
+        }
+        return result;
+    }
+};
+
+// ===== Плагіни фільтрів =====
+
+// ABI плагінів (NumberFilterPluginApi) описано в number_filter_plugin_api.h.
+
+// Завантажена бібліотека; вивантажується, коли зникає останній фільтр,
+// створений з неї.
+class FilterPlugin {
+    void* handle;
+    const NumberFilterPluginApi* table;
+
+    FilterPlugin(void* h, const NumberFilterPluginApi* t) : handle(h), table(t) {}
+
+public:
+    static std::shared_ptr<const FilterPlugin> load(const std::string& path) {
+        void* handle = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            throw std::runtime_error(std::string("Cannot load filter plugin: ") + ::dlerror());
+        }
+
+        using Entry = const NumberFilterPluginApi* (*)();
+        auto entry = reinterpret_cast<Entry>(::dlsym(handle, NUMBER_FILTER_PLUGIN_SYMBOL));
+        const NumberFilterPluginApi* table = entry ? entry() : nullptr;
+        if (!table || table->version != NUMBER_FILTER_PLUGIN_VERSION || !table->name || !*table->name || !table->create ||
+            !table->destroy) {
+            ::dlclose(handle);
+            throw std::runtime_error("Not a compatible filter plugin: " + path);
+        }
+        return std::shared_ptr<const FilterPlugin>(new FilterPlugin(handle, table));
+    }
+
+    ~FilterPlugin() {
+        ::dlclose(handle);
+    }
+
+    FilterPlugin(const FilterPlugin&) = delete;
+    FilterPlugin& operator=(const FilterPlugin&) = delete;
+
+    const NumberFilterPluginApi& api() const { return *table; }
+    std::string name() const { return table->name; }
+};
+
+template <class T>
+class PluginFilter final : public BasicNumberFilter<T> {
+    using Kernel = std::size_t (*)(const void*, const T*, std::size_t, T*);
+
+    std::shared_ptr<const FilterPlugin> plugin;
+    Kernel kernel;
+    void* state = nullptr;
+
+public:
+    PluginFilter(std::shared_ptr<const FilterPlugin> p, const std::string& spec) : plugin(std::move(p)) {
+        if constexpr (std::is_same_v<T, std::int64_t>) {
+            kernel = plugin->api().keep_batch_int64;
+        } else {
+            kernel = plugin->api().keep_batch_int32;
+        }
+        if (!kernel) {
+            throw std::invalid_argument("Filter plugin " + plugin->name() + " does not support " +
+                                        (sizeof(T) == 8 ? "int64" : "int32") + " values");
+        }
+
+        std::array<char, 256> error{};
+        state = plugin->api().create(spec.c_str(), error.data(), error.size());
+        if (!state) {
+            error.back() = '\0';
+            throw std::invalid_argument("Invalid " + plugin->name() + " filter: " + spec +
+                                        (error[0] ? std::string(": ") + error.data() : std::string()));
+        }
+    }
+
+    ~PluginFilter() override {
+        plugin->api().destroy(state);
+    }
+
+    PluginFilter(const PluginFilter&) = delete;
+    PluginFilter& operator=(const PluginFilter&) = delete;
+
+    bool keep(T number) const override {
+        T kept;
+        return kernel(state, &number, 1, &kept) == 1;
+    }
+
+    std::size_t keep_batch(std::span<const T> input, T* out) const override {
+        return kernel(state, input.data(), input.size(), out);
+    }
+};
+
+
+// ===== Фабрика фільтрів через реєстр =====
+
+// Викликає fn з object, приведеним до першого типу з Types, яким він є.
+template <class... Types, class Base, class Fn>
+bool visit_as(Base& object, Fn&& fn) {
+    auto try_type = [&](auto* typed) {
+        if (typed) {
+            fn(*typed);
+        }
+        return typed != nullptr;
+    };
+    return (try_type(dynamic_cast<Types*>(&object)) || ...);
+}
+
+// Префіксне дерево для вибору фабрики за початком специфікації. Вузли лежать
+// в одному векторі, діти кожного вузла відсортовані за символом.
+template <class Value>
+class PrefixTrie {
+    struct Node {
+        std::vector<std::pair<char, std::uint32_t>> children;
+        std::optional<Value> value;
+    };
+
+    std::vector<Node> nodes = std::vector<Node>(1);
+
+    const Node* child(const Node& node, char c) const {
+        auto it = std::lower_bound(node.children.begin(), node.children.end(), c,
+                                   [](const auto& edge, char key) { return edge.first < key; });
+        return it != node.children.end() && it->first == c ? &nodes[it->second] : nullptr;
+    }
+
+public:
+    // Повертає false, якщо ключ уже зареєстровано.
+    bool insert(std::string_view key, Value value) {
+        std::uint32_t current = 0;
+        for (char c : key) {
+            auto& children = nodes[current].children;
+            auto it = std::lower_bound(children.begin(), children.end(), c,
+                                       [](const auto& edge, char k) { return edge.first < k; });
+            if (it == children.end() || it->first != c) {
+                auto index = static_cast<std::uint32_t>(nodes.size());
+                // Спершу ребро, потім вузол: emplace_back може перенести children.
+                children.insert(it, { c, index });
+                nodes.emplace_back();
+                current = index;
+            } else {
+                current = it->second;
+            }
+        }
+        if (nodes[current].value) {
+            return false;
+        }
+        nodes[current].value = std::move(value);
+        return true;
+    }
+
+    // Значення найдовшого зареєстрованого ключа, яким починається text.
+    const Value* longest_prefix(std::string_view text) const {
+        const Node* node = &nodes[0];
+        const Value* found = node->value ? &*node->value : nullptr;
+        for (char c : text) {
+            node = child(*node, c);
+            if (!node) {
+                break;
+            }
+            if (node->value) {
+                found = &*node->value;
+            }
+        }
+        return found;
+    }
+};
+
+// Вбудовані фабрики — звичайні функції в дереві, що будується один раз на
+// процес; кожна фабрика отримує копію і може додати до неї плагіни.
+template <class T>
+class BasicFilterFactory {
+    struct Entry {
+        std::unique_ptr<BasicNumberFilter<T>> (*make)(const std::string&, const std::shared_ptr<const FilterPlugin>&);
+        std::shared_ptr<const FilterPlugin> plugin;
+    };
+
+    static std::unique_ptr<BasicNumberFilter<T>> make_even(const std::string&,
+                                                            const std::shared_ptr<const FilterPlugin>&) {
+        return std::make_unique<EvenFilter<T>>();
+    }
+
+    static std::unique_ptr<BasicNumberFilter<T>> make_odd(const std::string&,
+                                                           const std::shared_ptr<const FilterPlugin>&) {
+        return std::make_unique<OddFilter<T>>();
+    }
+
+    static std::unique_ptr<BasicNumberFilter<T>> make_gt(const std::string& input,
+                                                          const std::shared_ptr<const FilterPlugin>&) {
+        T threshold;
+        std::istringstream iss(input.substr(2));
+        if (!(iss >> threshold)) {
+            throw std::invalid_argument("Invalid GT filter format: " + input);
+        }
+        return std::make_unique<GreaterThanFilter<T>>(threshold);
+    }
+
+    static std::unique_ptr<BasicNumberFilter<T>> make_plugin(const std::string& input,
+                                                              const std::shared_ptr<const FilterPlugin>& plugin) {
+        return std::make_unique<PluginFilter<T>>(plugin, input);
+    }
+
+    static const PrefixTrie<Entry>& builtins() {
+        static const PrefixTrie<Entry> trie = [] {
+            PrefixTrie<Entry> t;
+            t.insert("EVEN", { &make_even, nullptr });
+            t.insert("ODD", { &make_odd, nullptr });
+            t.insert("GT", { &make_gt, nullptr });
+            return t;
+        }();
+        return trie;
+    }
+
+    PrefixTrie<Entry> registry = builtins();
+
+public:
+    // Фільтри плагіна обираються за його назвою як префіксом, так само як GT.
+    void register_plugin(std::shared_ptr<const FilterPlugin> plugin) {
+        std::string name = plugin->name();
+        if (!registry.insert(name, { &make_plugin, std::move(plugin) })) {
+            throw std::invalid_argument("Filter already registered: " + name);
+        }
+    }
+
+    // Одиночні токени з реєстру створюються як і раніше; усе інше (операції
+    // &, |, !, дужки, діапазони a..b, LT/GE/LE/EQ) компілюється у FusedFilter.
+    std::unique_ptr<BasicNumberFilter<T>> create_filter(const std::string& filter_str) const {
+        bool expression = filter_str.find_first_of("&|!()") != std::string::npos ||
+                          filter_str.find("..") != std::string::npos;
+        if (!expression) {
+            if (const Entry* entry = registry.longest_prefix(filter_str)) {
+                return entry->make(filter_str, entry->plugin);
+            }
+        }
+
+        return std::make_unique<FusedFilter<T>>(FilterExpressionParser<T>(filter_str).parse());
+    }
+
+    // Передає у fn вбудований фільтр під його конкретним типом, щоб шаблонний
+    // конвеєр міг вбудувати його виклики. Для сторонніх фільтрів повертає false.
+    template <class Fn>
+    static bool visit_builtin(const BasicNumberFilter<T>& filter, Fn&& fn) {
+        return visit_as<const EvenFilter<T>, const OddFilter<T>, const GreaterThanFilter<T>, const FusedFilter<T>>(
+            filter, fn);
+    }
+};
+
+using FilterFactory = BasicFilterFactory<int>;
+
+// ===== Фабрика читачів =====
+
+// Бінарний формат зберігає int32, тож читач "binary" є лише для int.
+template <class T>
+class BasicReaderFactory {
+    using FactoryFunction = std::function<std::unique_ptr<BasicNumberReader<T>>()>;
+    std::map<std::string, FactoryFunction> registry;
+
+public:
+    BasicReaderFactory() {
+        registry["stream"] = [] {
+            return std::make_unique<FileNumberReader<T>>();
+        };
+        registry["fast"] = [] {
+            return std::make_unique<FastFileNumberReader<T>>();
+        };
+        registry["mmap"] = [] {
+            return std::make_unique<MmapNumberReader<T>>();
+        };
+        registry["async"] = [] {
+            return std::make_unique<AsyncFileNumberReader<T>>();
+        };
+        if constexpr (std::is_same_v<T, int>) {
+            registry["binary"] = [] {
+                return std::make_unique<BinaryNumberReader>();
+            };
+        }
+    }
+
+    std::unique_ptr<BasicNumberReader<T>> create_reader(const std::string& name) const {
+        auto it = registry.find(name);
+        if (it == registry.end()) {
+            throw std::invalid_argument("Unknown reader: " + name);
+        }
+        return it->second();
+    }
+
+    // Бінарного читача тут немає: NumberProcessor обробляє його файли поблоково,
+    // використовуючи статистику блоків.
+    template <class Fn>
+    static bool visit_builtin(BasicNumberReader<T>& reader, Fn&& fn) {
+        return visit_as<FileNumberReader<T>, FastFileNumberReader<T>, MmapNumberReader<T>, AsyncFileNumberReader<T>>(
+            reader, fn);
+    }
+};
+
+using ReaderFactory = BasicReaderFactory<int>;
+
+// ===== Фабрика агрегатів =====
+
+// Агрегат задається як NAME або NAME:ARGS, наприклад top:5 чи histogram:0:999:10.
+template <class T>
+class BasicAggregateFactory {
+    using FactoryFunction =
+        std::function<std::unique_ptr<BasicMergeableObserver<T>>(const std::vector<std::string>&, const std::string&)>;
+    std::map<std::string, FactoryFunction> registry;
+
+    template <class Value = T>
+    static Value parse_value(const std::string& value, const std::string& spec) {
+        Value parsed = 0;
+        auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+        if (ec != std::errc() || end != value.data() + value.size()) {
+            throw std::invalid_argument("Invalid aggregate argument: " + spec);
+        }
+        return parsed;
+    }
+
+    static void expect_args(const std::vector<std::string>& args, std::size_t count, const std::string& name) {
+        if (!args.empty() && args.size() != count) {
+            throw std::invalid_argument("Wrong number of arguments for aggregate: " + name);
+        }
+    }
+
+public:
+    BasicAggregateFactory() {
+        registry["sum"] = [](const std::vector<std::string>& args, const std::string& label) {
+            expect_args(args, 0, "sum");
+            return std::make_unique<SumObserver<T>>(label);
+        };
+        registry["minmax"] = [](const std::vector<std::string>& args, const std::string& label) {
+            expect_args(args, 0, "minmax");
+            return std::make_unique<MinMaxObserver<T>>(label);
+        };
+        registry["distinct"] = [](const std::vector<std::string>& args, const std::string& label) {
+            expect_args(args, 0, "distinct");
+            return std::make_unique<DistinctObserver<T>>(label);
+        };
+        registry["top"] = [](const std::vector<std::string>& args, const std::string& label) {
+            expect_args(args, 1, "top");
+            int k = args.empty() ? 10 : parse_value<int>(args[0], "top");
+            if (k <= 0) {
+                throw std::invalid_argument("Top-k size must be positive");
+            }
+            return std::make_unique<TopKObserver<T>>(static_cast<std::size_t>(k), label);
+        };
+        // Без аргументів — 16 кошиків на весь діапазон T.
+        registry["histogram"] = [](const std::vector<std::string>& args, const std::string& label) {
+            expect_args(args, 3, "histogram");
+            if (args.empty()) {
+                return std::make_unique<HistogramObserver<T>>(std::numeric_limits<T>::min(),
+                                                              std::numeric_limits<T>::max(), 16, label);
+            }
+            int buckets = parse_value<int>(args[2], "histogram");
+            if (buckets <= 0) {
+                throw std::invalid_argument("Invalid histogram range");
+            }
+            return std::make_unique<HistogramObserver<T>>(parse_value(args[0], "histogram"),
+                                                          parse_value(args[1], "histogram"),
+                                                          static_cast<std::size_t>(buckets), label);
+        };
+    }
+
+    std::unique_ptr<BasicMergeableObserver<T>> create_aggregate(const std::string& spec,
+                                                                const std::string& label = {}) const {
+        std::vector<std::string> parts;
+        std::size_t begin = 0;
+        while (true) {
+            std::size_t colon = spec.find(':', begin);
+            parts.push_back(spec.substr(begin, colon == std::string::npos ? std::string::npos : colon - begin));
+            if (colon == std::string::npos) {
+                break;
+            }
+            begin = colon + 1;
+        }
+
+        auto it = registry.find(parts[0]);
+        if (it == registry.end()) {
+            throw std::invalid_argument("Unknown aggregate: " + parts[0]);
+        }
+        return it->second({parts.begin() + 1, parts.end()}, label);
+    }
+};
+
+using AggregateFactory = BasicAggregateFactory<int>;
+
+// ===== Обробник чисел =====
+
+struct ProcessorOptions {
+    std::size_t chunk_size = kDefaultChunkSize;
+    unsigned threads = 1;
+    // false: результати шматків передаються обсерверам у порядку завершення.
+    bool ordered = true;
+    // Непорожнє: збирати лічильники етапів для --stats.
+    PipelineStats* stats = nullptr;
+};
+
+// Запит: фільтр і обсервери, що отримують значення, які він пропустив.
+template <class T>
+struct BasicNumberQuery {
+    BasicNumberFilter<T>* filter;
+    std::vector<BasicNumberObserver<T>*> observers;
+};
+
+using NumberQuery = BasicNumberQuery<int>;
+
+// Виконує один або кілька запитів за один прохід по даних: розбір тексту
+// (чи розпаковка блоків) відбувається один раз, а кожен фільтр працює над
+// тим самим буфером значень.
+template <class T>
+class BasicNumberProcessor {
+    static constexpr std::size_t kMinPieceBytes = 1 << 20;
+    static constexpr std::size_t kMaxPieceBytes = 64 << 20;
+
+    struct Query {
+        BasicNumberFilter<T>* filter;
+        std::vector<BasicNumberObserver<T>*> observers;
+        // Для паралельного режиму: агрегати рахуються у воркерах, решта — в головному потоці.
+        std::vector<BasicMergeableObserver<T>*> mergeable;
+        std::vector<BasicNumberObserver<T>*> direct;
+        bool need_values = false;
+    };
+
+    struct PieceResult {
+        std::vector<T> selected;
+        std::vector<std::unique_ptr<BasicMergeableObserver<T>>> partials;
+    };
+
+    struct Piece {
+        const char* begin;
+        const char* end;
+        std::vector<PieceResult> results;
+        bool failed = false;
+        PipelineStats stats;
+    };
+
+    // Робочі буфери потоку обробки; живуть разом з обробником, тож
+    // переходять від файлу до файлу без нових алокацій.
+    struct WorkBuffers {
+        std::vector<T> scratch;
+        std::vector<T> selected;
+    };
+
+    BasicNumberReader<T>& reader;
+    std::vector<Query> queries;
+    ProcessorOptions options;
+    std::vector<WorkBuffers> work;
+
+    void finish() {
+        StageTimer timer(options.stats);
+        for (auto& query : queries) {
+            for (auto* obs : query.observers) {
+                obs->on_finished();
+            }
+        }
+        timer.lap(&PipelineStats::observer_ns);
+    }
+
+    void dispatch(std::span<const T> chunk, std::vector<T>& selected, StageTimer& timer) {
+        if (selected.size() < chunk.size()) {
+            selected.resize(chunk.size());
+        }
+
+        for (std::size_t q = 0; q < queries.size(); ++q) {
+            std::size_t kept = queries[q].filter->keep_batch(chunk, selected.data());
+            timer.lap(&PipelineStats::filter_ns);
+            if (options.stats) {
+                options.stats->selected[q] += kept;
+            }
+            if (kept == 0) {
+                continue;
+            }
+            for (auto* obs : queries[q].observers) {
+                obs->on_batch({selected.data(), kept});
+            }
+            timer.lap(&PipelineStats::observer_ns);
+        }
+    }
+
+    // Час next_chunk() записується як розбір; очікування read() потік
+    // рахує окремо, тож наприкінці воно віднімається.
+    void run_stream(const std::string& filename) {
+        auto stream = reader.open_stream(filename, options.chunk_size);
+        stream->collect_stats(options.stats);
+        std::vector<T>& selected = work[0].selected;
+        std::uint64_t read_before = options.stats ? options.stats->read_ns : 0;
+
+        StageTimer timer(options.stats);
+        while (true) {
+            auto chunk = stream->next_chunk();
+            timer.lap(&PipelineStats::parse_ns);
+            if (chunk.empty()) {
+                break;
+            }
+            if (options.stats) {
+                options.stats->values_parsed += chunk.size();
+            }
+            dispatch(chunk, selected, timer);
+        }
+
+        if (options.stats) {
+            options.stats->parse_ns -= options.stats->read_ns - read_before;
+        }
+    }
+
+    // Розбирає [p, end) і передає значення запитам; false — трапився
+    // некоректний токен.
+    bool dispatch_text(const char* p, const char* end, std::vector<T>& values, std::vector<T>& selected,
+                       StageTimer& timer) {
+        bool failed = false;
+        while (p != end && !failed) {
+            values.clear();
+            p = parse_numbers(p, end, values, options.chunk_size, failed);
+            timer.lap(&PipelineStats::parse_ns);
+            if (options.stats) {
+                options.stats->values_parsed += values.size();
+            }
+            dispatch(values, selected, timer);
+        }
+        return !failed;
+    }
+
+    // Обходить блоки бінарного файлу в [p, end). За статистикою блоку кожен
+    // фільтр може відкинути його або прийняти цілком без фільтрації; якщо ж
+    // значення запиту не потрібні (need_values(q) == false), прийнятий блок
+    // передається лише кількістю через count(q, n). Решта значень — через
+    // emit(q, span). Блок розпаковується не більше одного разу на всі запити.
+    template <class NeedValues, class Emit, class Count>
+    void scan_blocks(const BinaryFileHeader& header, const char* p, const char* end, std::vector<T>& scratch,
+                     std::vector<T>& selected, PipelineStats* counters, NeedValues&& need_values, Emit&& emit,
+                     Count&& count) const {
+        StageTimer timer(counters);
+        auto take = [&](std::size_t q, std::size_t n) {
+            if (counters) {
+                counters->selected[q] += n;
+            }
+        };
+
+        while (p != end) {
+            BinaryBlock block;
+            p = next_block(p, end, header, block);
+            BlockStats stats = block_stats(block);
+            std::span<const T> values;
+            bool decoded = false;
+            if (counters) {
+                ++counters->blocks;
+                counters->values_parsed += stats.count;
+            }
+            timer.lap(&PipelineStats::parse_ns);
+
+            for (std::size_t q = 0; q < queries.size(); ++q) {
+                const BasicNumberFilter<T>& filter = *queries[q].filter;
+                BlockMatch match = filter.classify_block(stats);
+                if (match == BlockMatch::NONE) {
+                    continue;
+                }
+                if (match == BlockMatch::ALL && !need_values(q)) {
+                    count(q, stats.count);
+                    take(q, stats.count);
+                    timer.lap(&PipelineStats::observer_ns);
+                    continue;
+                }
+
+                if (!decoded) {
+                    values = block_values(block, scratch);
+                    decoded = true;
+                    if (counters) {
+                        ++counters->blocks_decoded;
+                    }
+                    timer.lap(&PipelineStats::parse_ns);
+                }
+                for (std::size_t offset = 0; offset < values.size(); offset += options.chunk_size) {
+                    auto part = values.subspan(offset, std::min(options.chunk_size, values.size() - offset));
+                    if (match == BlockMatch::ALL) {
+                        emit(q, part);
+                        take(q, part.size());
+                    } else {
+                        std::size_t kept = filter.keep_batch(part, selected.data());
+                        timer.lap(&PipelineStats::filter_ns);
+                        emit(q, std::span<const T>(selected.data(), kept));
+                        take(q, kept);
+                    }
+                    timer.lap(&PipelineStats::observer_ns);
+                }
+            }
+        }
+    }
+
+    void run_binary(const MappedFile& file, const BinaryFileHeader& header) {
+        std::vector<T>& scratch = work[0].scratch;
+        std::vector<T>& selected = work[0].selected;
+        scan_blocks(header, file.data() + sizeof(BinaryFileHeader), file.data() + file.size(), scratch, selected,
+            options.stats,
+            [&](std::size_t q) { return queries[q].need_values; },
+            [&](std::size_t q, std::span<const T> values) {
+                if (values.empty()) {
+                    return;
+                }
+                for (auto* obs : queries[q].observers) {
+                    obs->on_batch(values);
+                }
+            },
+            [&](std::size_t q, std::size_t n) {
+                for (auto* obs : queries[q].observers) {
+                    obs->on_count(n);
+                }
+            });
+    }
+
+    // Ріже файл на шматки, межі яких зсунуті до найближчого пробільного символу,
+    // тож кожен токен повністю належить одному шматку.
+    std::vector<Piece> split(const MappedFile& file) const {
+        std::size_t piece_bytes = file.size() / (options.threads * 8);
+        piece_bytes = std::clamp(piece_bytes, kMinPieceBytes, kMaxPieceBytes);
+
+        std::vector<Piece> pieces;
+        const char* data = file.data();
+        const char* end = data + file.size();
+        for (const char* begin = data; begin != end;) {
+            const char* stop = end - begin > static_cast<std::ptrdiff_t>(piece_bytes) ? begin + piece_bytes : end;
+            while (stop != end && !is_space(*stop)) {
+                ++stop;
+            }
+            pieces.push_back(Piece{begin, stop, {}, false, {}});
+            begin = stop;
+        }
+        return pieces;
+    }
+
+    // Для бінарного формату межі шматків збігаються з межами блоків.
+    std::vector<Piece> split_binary(const MappedFile& file, const BinaryFileHeader& header) const {
+        std::size_t piece_bytes = file.size() / (options.threads * 8);
+        piece_bytes = std::clamp(piece_bytes, kMinPieceBytes, kMaxPieceBytes);
+
+        std::vector<Piece> pieces;
+        const char* end = file.data() + file.size();
+        const char* begin = file.data() + sizeof(BinaryFileHeader);
+        for (const char* p = begin; p != end;) {
+            BinaryBlock block;
+            p = next_block(p, end, header, block);
+            if (p == end || p - begin >= static_cast<std::ptrdiff_t>(piece_bytes)) {
+                pieces.push_back(Piece{begin, p, {}, false, {}});
+                begin = p;
+            }
+        }
+        return pieces;
+    }
+
+    // Значення запиту зберігаються в шматку, лише якщо є обсервери, які
+    // отримують їх у головному потоці. binary — заголовок бінарного файлу,
+    // nullptr для тексту.
+    void process_piece(Piece& piece, const BinaryFileHeader* binary, std::vector<T>& scratch,
+                       std::vector<T>& selected) const {
+        PipelineStats* counters = nullptr;
+        if (options.stats) {
+            piece.stats.selected.assign(queries.size(), 0);
+            counters = &piece.stats;
+        }
+        piece.results.resize(queries.size());
+        for (std::size_t q = 0; q < queries.size(); ++q) {
+            for (auto* obs : queries[q].mergeable) {
+                piece.results[q].partials.push_back(obs->make_partial());
+            }
+        }
+
+        auto emit = [&](std::size_t q, std::span<const T> values) {
+            PieceResult& result = piece.results[q];
+            for (auto& partial : result.partials) {
+                partial->on_batch(values);
+            }
+            if (!queries[q].direct.empty()) {
+                result.selected.insert(result.selected.end(), values.begin(), values.end());
+            }
+        };
+
+        // Бінарні шматки бувають лише в int-конвеєрі.
+        if constexpr (std::is_same_v<T, int>) {
+            if (binary) {
+                auto need_values = [&](std::size_t q) { return queries[q].need_values; };
+                auto count = [&](std::size_t q, std::size_t n) {
+                    for (auto& partial : piece.results[q].partials) {
+                        partial->on_count(n);
+                    }
+                };
+                scan_blocks(*binary, piece.begin, piece.end, scratch, selected, counters, need_values, emit, count);
+                return;
+            }
+        }
+
+        StageTimer timer(counters);
+        const char* p = piece.begin;
+        while (p != piece.end && !piece.failed) {
+            scratch.clear();
+            p = parse_numbers(p, piece.end, scratch, options.chunk_size, piece.failed);
+            timer.lap(&PipelineStats::parse_ns);
+            if (counters) {
+                counters->values_parsed += scratch.size();
+            }
+            for (std::size_t q = 0; q < queries.size(); ++q) {
+                std::size_t kept = queries[q].filter->keep_batch(scratch, selected.data());
+                timer.lap(&PipelineStats::filter_ns);
+                if (counters) {
+                    counters->selected[q] += kept;
+                }
+                emit(q, std::span<const T>(selected.data(), kept));
+                timer.lap(&PipelineStats::observer_ns);
+            }
+        }
+    }
+
+    // Агрегати (BasicMergeableObserver<T>) рахуються у воркерах, решта обсерверів
+    // отримує відфільтровані значення в головному потоці. Як і у послідовному
+    // режимі, обробка зупиняється на шматку з першим некоректним токеном;
+    // в unordered-режимі значення пізніших шматків, які вже були передані
+    // обсерверам до цього моменту, не відкликаються.
+    void run_parallel(const MappedFile& file, const BinaryFileHeader* binary) {
+        std::vector<Piece> pieces = binary ? split_binary(file, *binary) : split(file);
+        const std::size_t window = options.threads * 2;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t next = 0;
+        std::size_t released = 0;
+        std::size_t stop_at = pieces.size();
+        std::vector<bool> done(pieces.size(), false);
+        std::deque<std::size_t> finished;
+        std::exception_ptr error;
+
+        auto worker = [&](WorkBuffers& buffers) {
+            std::vector<T>& scratch = buffers.scratch;
+            std::vector<T>& selected = buffers.selected;
+
+            while (true) {
+                std::size_t index;
+                {
+                    std::unique_lock lock(mutex);
+                    cv.wait(lock, [&] { return next >= stop_at || next < released + window; });
+                    if (next >= stop_at) {
+                        return;
+                    }
+                    index = next++;
+                }
+
+                try {
+                    process_piece(pieces[index], binary, scratch, selected);
+                } catch (...) {
+                    std::lock_guard lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    stop_at = 0;
+                }
+
+                {
+                    std::lock_guard lock(mutex);
+                    done[index] = true;
+                    finished.push_back(index);
+                }
+                cv.notify_all();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < options.threads; ++i) {
+            workers.emplace_back(worker, std::ref(work[i]));
+        }
+
+        auto deliver = [&](Piece& piece) {
+            StageTimer timer(options.stats);
+            for (std::size_t q = 0; q < queries.size(); ++q) {
+                std::span<const T> values = piece.results[q].selected;
+                for (std::size_t offset = 0; offset < values.size(); offset += options.chunk_size) {
+                    auto block = values.subspan(offset, std::min(options.chunk_size, values.size() - offset));
+                    for (auto* obs : queries[q].direct) {
+                        obs->on_batch(block);
+                    }
+                }
+                std::vector<T>().swap(piece.results[q].selected);
+            }
+            timer.lap(&PipelineStats::observer_ns);
+        };
+
+        if (options.ordered) {
+            for (std::size_t index = 0;; ++index) {
+                {
+                    std::unique_lock lock(mutex);
+                    cv.wait(lock, [&] { return index >= stop_at || done[index]; });
+                    if (index >= stop_at) {
+                        break;
+                    }
+                }
+
+                deliver(pieces[index]);
+
+                {
+                    std::lock_guard lock(mutex);
+                    released = index + 1;
+                    if (pieces[index].failed) {
+                        stop_at = std::min(stop_at, index + 1);
+                    }
+                }
+                cv.notify_all();
+            }
+        } else {
+            std::vector<bool> delivered(pieces.size(), false);
+            std::size_t first_pending = 0;
+            while (true) {
+                std::size_t index;
+                {
+                    std::unique_lock lock(mutex);
+                    cv.wait(lock, [&] { return first_pending >= stop_at || !finished.empty(); });
+                    if (first_pending >= stop_at) {
+                        break;
+                    }
+                    index = finished.front();
+                    finished.pop_front();
+                }
+
+                if (index < stop_at) {
+                    deliver(pieces[index]);
+                }
+
+                {
+                    std::lock_guard lock(mutex);
+                    delivered[index] = true;
+                    while (first_pending < pieces.size() && delivered[first_pending]) {
+                        ++first_pending;
+                    }
+                    ++released;
+                    if (index < stop_at && pieces[index].failed) {
+                        stop_at = index + 1;
+                    }
+                }
+                cv.notify_all();
+            }
+        }
+
+        for (auto& t : workers) {
+            t.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        if (options.stats) {
+            options.stats->threads = options.threads;
+        }
+        for (std::size_t index = 0; index < stop_at; ++index) {
+            if (options.stats) {
+                options.stats->merge(pieces[index].stats);
+            }
+            for (std::size_t q = 0; q < queries.size(); ++q) {
+                auto& mergeable = queries[q].mergeable;
+                for (std::size_t i = 0; i < mergeable.size(); ++i) {
+                    mergeable[i]->merge(*pieces[index].results[q].partials[i]);
+                }
+            }
+        }
+    }
+
+public:
+    BasicNumberProcessor(BasicNumberReader<T>& r, BasicNumberFilter<T>& f,
+                         const std::vector<BasicNumberObserver<T>*>& obs, ProcessorOptions opts = {})
+        : BasicNumberProcessor(r, std::vector<BasicNumberQuery<T>>{ BasicNumberQuery<T>{&f, obs} }, opts) {}
+
+    BasicNumberProcessor(BasicNumberReader<T>& r, const std::vector<BasicNumberQuery<T>>& list,
+                         ProcessorOptions opts = {})
+        : reader(r), options(opts) {
+        if (options.chunk_size == 0 || options.threads == 0) {
+            throw std::invalid_argument("Chunk size and thread count must be positive");
+        }
+        if (list.empty()) {
+            throw std::invalid_argument("At least one query is required");
+        }
+
+        for (const auto& item : list) {
+            Query query{item.filter, item.observers, {}, {}, false};
+            for (auto* obs : item.observers) {
+                if (auto* m = dynamic_cast<BasicMergeableObserver<T>*>(obs)) {
+                    query.mergeable.push_back(m);
+                } else {
+                    query.direct.push_back(obs);
+                }
+                query.need_values = query.need_values || obs->needs_values();
+            }
+            queries.push_back(std::move(query));
+        }
+        if (options.stats) {
+            options.stats->selected.assign(queries.size(), 0);
+        }
+
+        work.resize(options.threads);
+        for (auto& buffers : work) {
+            buffers.scratch.reserve(options.chunk_size);
+            buffers.selected.resize(options.chunk_size);
+        }
+    }
+
+    // Кілька файлів обробляються як один потік даних: обсервери отримують
+    // значення всіх файлів по черзі, а підсумки виводяться один раз у кінці.
+    // Буфери обробника і читача переходять від файлу до файлу.
+    void run(const std::vector<std::string>& filenames) {
+        StageTimer total(options.stats);
+        for (const auto& filename : filenames) {
+            process(filename);
+        }
+        finish();
+        total.lap(&PipelineStats::total_ns);
+    }
+
+    void run(const std::string& filename) {
+        run(std::vector<std::string>{ filename });
+    }
+
+private:
+    // Паралельний режим працює лише для файлів, які можна відобразити у пам'ять;
+    // для пайпів і пристроїв використовується послідовний читач. Бінарні файли
+    // завжди обробляються поблоково, щоб використати статистику блоків.
+    void process(const std::string& filename) {
+        if constexpr (std::is_same_v<T, int>) {
+            if (dynamic_cast<BinaryNumberReader*>(&reader)) {
+                process_binary(filename);
+                return;
+            }
+        }
+
+        std::unique_ptr<MappedFile> file;
+        if (options.threads > 1) {
+            file = MappedFile::open(filename);
+        }
+
+        if (file) {
+            if (options.stats) {
+                options.stats->bytes_read += file->size();
+            }
+            run_parallel(*file, nullptr);
+        } else {
+            run_stream(filename);
+        }
+    }
+
+    void process_binary(const std::string& filename) {
+        auto file = MappedFile::open(filename);
+        if (!file) {
+            throw std::runtime_error("Binary input must be a regular file: " + filename);
+        }
+        const BinaryFileHeader& header = binary_header(*file, filename);
+        if (options.stats) {
+            options.stats->bytes_read += file->size();
+        }
+        if (options.threads > 1) {
+            run_parallel(*file, &header);
+        } else {
+            run_binary(*file, header);
+        }
+    }
+
+public:
+
+    // Режим спостереження: обробляє наявний вміст текстового файлу, а далі
+    // лише дописані байти, прокидаючись за подіями inotify. Стан обсерверів
+    // зберігається, і після кожної порції on_finished() виводить оновлені
+    // підсумки. Незавершений токен у кінці файлу чекає наступного запису;
+    // якщо файл обрізано, читання починається спочатку. Повертається, коли
+    // файл видалено або трапився некоректний токен.
+    void follow(const std::string& filename) {
+        StageTimer total(options.stats);
+        if (dynamic_cast<BinaryNumberReader*>(&reader)) {
+            throw std::invalid_argument("--follow needs text input");
+        }
+
+        FileDescriptor fd(open_input(filename));
+        struct stat info;
+        if (fd.get() < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        if (::fstat(fd.get(), &info) != 0 || !S_ISREG(info.st_mode)) {
+            throw std::runtime_error("--follow needs a regular file: " + filename);
+        }
+
+        // Через /proc/self/fd спостерігаємо саме відкритий файл, навіть для "-".
+        FileDescriptor notify(::inotify_init1(IN_CLOEXEC));
+        std::string watched = "/proc/self/fd/" + std::to_string(fd.get());
+        if (notify.get() < 0 || ::inotify_add_watch(notify.get(), watched.c_str(), IN_MODIFY | IN_ATTRIB) < 0) {
+            throw std::runtime_error(std::string("Cannot watch file: ") + std::strerror(errno));
+        }
+
+        std::vector<char> bytes(kMinPieceBytes);
+        std::size_t pending = 0;
+        off_t offset = ::lseek(fd.get(), 0, SEEK_CUR);
+        std::vector<T> values;
+        values.reserve(options.chunk_size);
+        std::vector<T> selected(options.chunk_size);
+        bool valid = true;
+
+        // Дочитує файл до кінця; повертає true, якщо розібрано нові токени.
+        auto drain = [&] {
+            bool changed = false;
+            while (valid) {
+                if (pending == bytes.size()) {
+                    bytes.resize(bytes.size() * 2);
+                }
+                StageTimer timer(options.stats);
+                ssize_t n = ::read(fd.get(), bytes.data() + pending, bytes.size() - pending);
+                timer.lap(&PipelineStats::read_ns);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error(std::string("Read error: ") + std::strerror(errno));
+                }
+                if (n == 0) {
+                    break;
+                }
+                offset += n;
+                if (options.stats) {
+                    options.stats->bytes_read += static_cast<std::uint64_t>(n);
+                }
+
+                std::size_t end = pending + static_cast<std::size_t>(n);
+                std::size_t stop = end;
+                while (stop > 0 && !is_space(bytes[stop - 1])) {
+                    --stop;
+                }
+                if (stop > 0) {
+                    valid = dispatch_text(bytes.data(), bytes.data() + stop, values, selected, timer);
+                    changed = true;
+                }
+                std::memmove(bytes.data(), bytes.data() + stop, end - stop);
+                pending = end - stop;
+            }
+            return changed;
+        };
+
+        drain();
+        finish();
+
+        alignas(inotify_event) std::array<char, 4096> events;
+        while (valid) {
+            if (::read(notify.get(), events.data(), events.size()) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Watch error: ") + std::strerror(errno));
+            }
+            if (::fstat(fd.get(), &info) != 0) {
+                throw std::runtime_error(std::string("Cannot stat file: ") + std::strerror(errno));
+            }
+            if (info.st_size < offset) {
+                ::lseek(fd.get(), 0, SEEK_SET);
+                offset = 0;
+                pending = 0;
+            }
+            if (drain()) {
+                finish();
+            }
+            if (info.st_nlink == 0) {
+                break;
+            }
+        }
+
+        // Файл видалено: останній токен уже не буде дописано.
+        if (valid && pending > 0) {
+            StageTimer timer(options.stats);
+            dispatch_text(bytes.data(), bytes.data() + pending, values, selected, timer);
+            finish();
+        }
+        total.lap(&PipelineStats::total_ns);
+    }
+};
+
+using NumberProcessor = BasicNumberProcessor<int>;
+
+// ===== Статично спеціалізований конвеєр =====
+
+// Послідовний конвеєр з конкретними типами читача, фільтра й обсерверів:
+// класи final, тож виклики в гарячому циклі не віртуальні і вбудовуються.
+template <class Reader, class Filter, class... Observers>
+class StaticNumberProcessor {
+    Reader& reader;
+    const Filter& filter;
+    std::tuple<Observers&...> observers;
+    std::size_t chunk_size;
+
+public:
+    StaticNumberProcessor(Reader& r, const Filter& f, std::tuple<Observers&...> obs,
+                          std::size_t chunk = kDefaultChunkSize)
+        : reader(r), filter(f), observers(obs), chunk_size(chunk) {}
+
+    void run(const std::string& filename) {
+        using Value = typename Filter::value_type;
+        auto stream = reader.open_stream(filename, chunk_size);
+        std::vector<Value> selected(chunk_size);
+
+        for (auto chunk = stream->next_chunk(); !chunk.empty(); chunk = stream->next_chunk()) {
+            if (selected.size() < chunk.size()) {
+                selected.resize(chunk.size());
+            }
+
+            std::size_t kept = filter.keep_batch(chunk, selected.data());
+            if (kept == 0) {
+                continue;
+            }
+            std::span<const Value> block(selected.data(), kept);
+            std::apply([&](auto&... obs) { (obs.on_batch(block), ...); }, observers);
+        }
+
+        std::apply([](auto&... obs) { (obs.on_finished(), ...); }, observers);
+    }
+};
+
+// Запускає StaticNumberProcessor, якщо і читач, і фільтр вбудовані.
+// Повертає false, коли потрібен поліморфний NumberProcessor.
+template <class T, class... Observers>
+bool run_static(BasicNumberReader<T>& reader, const BasicNumberFilter<T>& filter, const std::string& filename,
+                std::size_t chunk_size, Observers&... observers) {
+    bool handled = false;
+    BasicReaderFactory<T>::visit_builtin(reader, [&](auto& typed_reader) {
+        handled = BasicFilterFactory<T>::visit_builtin(filter, [&](const auto& typed_filter) {
+            StaticNumberProcessor processor(typed_reader, typed_filter, std::tie(observers...), chunk_size);
+            processor.run(filename);
+        });
+    });
+    return handled;
+}
+
+// ===== Параметри командного рядка =====
+
+struct PipelineOptions {
+    std::vector<std::string> filters;
+    // Файли або каталоги; каталог розгортається у свої файли.
+    std::vector<std::string> inputs;
+    std::string reader = "stream";
+    // Тип значень: "int32" або "int64".
+    std::string type = "int32";
+    std::size_t chunk_size = kDefaultChunkSize;
+    unsigned threads = 1;
+    bool ordered = true;
+    bool dynamic = false;
+    bool buffered_output = false;
+    int output_fd = STDOUT_FILENO;
+    bool count_only = false;
+    bool follow = false;
+    // "text" або "json": надрукувати лічильники етапів у stderr.
+    std::string stats;
+    std::vector<std::string> aggregates;
+    // Спільні бібліотеки з додатковими фільтрами.
+    std::vector<std::string> plugins;
+    // Непорожнє: перетворити inputs[0] у бінарний формат з цим кодуванням.
+    std::string convert;
+    std::string output;
+};
+
+std::size_t parse_size(const std::string& name, const std::string& value) {
+    std::size_t parsed = 0;
+    std::size_t pos = 0;
+    try {
+        parsed = std::stoull(value, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos != value.size() || value.empty() || value[0] == '-' || parsed == 0) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value);
+    }
+    return parsed;
+}
+
+PipelineOptions parse_options(int argc, char* argv[]) {
+    PipelineOptions options;
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--chunk-size=", 0) == 0) {
+            options.chunk_size = parse_size("--chunk-size", arg.substr(13));
+        } else if (arg.rfind("--reader=", 0) == 0) {
+            options.reader = arg.substr(9);
+        } else if (arg.rfind("--type=", 0) == 0) {
+            options.type = arg.substr(7);
+            if (options.type != "int32" && options.type != "int64") {
+                throw std::invalid_argument("Unknown value type: " + options.type);
+            }
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            options.threads = static_cast<unsigned>(parse_size("--threads", arg.substr(10)));
+        } else if (arg == "--unordered") {
+            options.ordered = false;
+        } else if (arg == "--dynamic") {
+            options.dynamic = true;
+        } else if (arg.rfind("--aggregate=", 0) == 0) {
+            std::string list = arg.substr(12);
+            for (std::size_t begin = 0; begin <= list.size();) {
+                std::size_t comma = std::min(list.find(',', begin), list.size());
+                if (comma > begin) {
+                    options.aggregates.push_back(list.substr(begin, comma - begin));
+                }
+                begin = comma + 1;
+            }
+        } else if (arg.rfind("--plugin=", 0) == 0) {
+            options.plugins.push_back(arg.substr(9));
+        } else if (arg == "--count-only") {
+            options.count_only = true;
+        } else if (arg.rfind("--input=", 0) == 0) {
+            options.inputs.push_back(arg.substr(8));
+        } else if (arg == "--follow") {
+            options.follow = true;
+        } else if (arg == "--stats" || arg.rfind("--stats=", 0) == 0) {
+            options.stats = arg == "--stats" ? "text" : arg.substr(8);
+            if (options.stats != "text" && options.stats != "json") {
+                throw std::invalid_argument("Unknown stats format: " + options.stats);
+            }
+        } else if (arg == "--buffered-output") {
+            options.buffered_output = true;
+        } else if (arg.rfind("--output-fd=", 0) == 0) {
+            std::string value = arg.substr(12);
+            options.output_fd = value == "0" ? 0 : static_cast<int>(parse_size("--output-fd", value));
+            options.buffered_output = true;
+        } else if (arg == "--convert" || arg.rfind("--convert=", 0) == 0) {
+            options.convert = arg == "--convert" ? "raw" : arg.substr(10);
+            if (options.convert != "raw" && options.convert != "delta") {
+                throw std::invalid_argument("Unknown encoding: " + options.convert);
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            throw std::invalid_argument("Unknown option: " + arg);
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    // Бінарний формат зберігає лише int32.
+    if (options.type != "int32" && (!options.convert.empty() || options.reader == "binary")) {
+        throw std::invalid_argument("The binary format stores int32 values; use --type=int32");
+    }
+
+    if (!options.convert.empty()) {
+        if (options.follow) {
+            throw std::invalid_argument("--follow cannot be combined with --convert");
+        }
+        if (positional.size() != 2 || !options.inputs.empty()) {
+            throw std::invalid_argument("Expected <INPUT> and <OUTPUT> for --convert");
+        }
+        options.inputs.push_back(positional[0]);
+        options.output = positional[1];
+        return options;
+    }
+
+    // З --input усі позиційні аргументи — фільтри.
+    if (options.inputs.empty()) {
+        if (positional.size() < 2) {
+            throw std::invalid_argument("Expected <FILTER>... and <FILENAME>");
+        }
+        options.inputs.push_back(positional.back());
+        positional.pop_back();
+    }
+    if (positional.empty()) {
+        throw std::invalid_argument("Expected at least one <FILTER>");
+    }
+    if (options.follow && options.inputs.size() != 1) {
+        throw std::invalid_argument("--follow needs exactly one file");
+    }
+
+    options.filters = std::move(positional);
+    return options;
+}
+
+// Каталог замінюється його звичайними файлами в порядку імен, без рекурсії.
+std::vector<std::string> expand_inputs(const std::vector<std::string>& paths) {
+    std::vector<std::string> files;
+    for (const auto& path : paths) {
+        std::error_code error;
+        if (!std::filesystem::is_directory(path, error)) {
+            files.push_back(path);
+            continue;
+        }
+
+        std::vector<std::string> entries;
+        for (const auto& entry : std::filesystem::directory_iterator(path)) {
+            if (entry.is_regular_file()) {
+                entries.push_back(entry.path().string());
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        files.insert(files.end(), entries.begin(), entries.end());
+    }
+    return files;
+}
+
+// ===== main =====
+
+#ifndef NUMBER_PIPELINE_NO_MAIN
+// Кожен фільтр — окремий запит зі своїми обсерверами; з кількома
+// фільтрами підсумок підписується виразом фільтра.
+template <class T>
+void run_pipeline(const PipelineOptions& options) {
+    BasicReaderFactory<T> readers;
+    auto reader = readers.create_reader(options.reader);
+
+    BasicFilterFactory<T> factory;
+    for (const auto& path : options.plugins) {
+        factory.register_plugin(FilterPlugin::load(path));
+    }
+    BasicAggregateFactory<T> aggregateFactory;
+    std::vector<std::unique_ptr<BasicNumberFilter<T>>> filters;
+    std::vector<std::unique_ptr<BasicNumberObserver<T>>> printObservers;
+    std::vector<std::unique_ptr<BasicCountObserver<T>>> countObservers;
+    std::vector<std::unique_ptr<BasicMergeableObserver<T>>> aggregates;
+    std::vector<BasicNumberQuery<T>> queries;
+    for (const auto& spec : options.filters) {
+        std::string label = options.filters.size() > 1 ? spec : "";
+        filters.push_back(factory.create_filter(spec));
+        countObservers.push_back(std::make_unique<BasicCountObserver<T>>(label));
+
+        std::unique_ptr<BasicNumberObserver<T>> printObserver;
+        if (options.count_only) {
+            // Лише CountObserver: для бінарних файлів відповідь береться з індексу блоків.
+        } else if (options.buffered_output) {
+            printObserver = std::make_unique<BasicBufferedPrintObserver<T>>(options.output_fd);
+        } else {
+            printObserver = std::make_unique<BasicPrintObserver<T>>();
+        }
+
+        BasicNumberQuery<T> query{filters.back().get(), {countObservers.back().get()}};
+        if (printObserver) {
+            query.observers.insert(query.observers.begin(), printObserver.get());
+            printObservers.push_back(std::move(printObserver));
+        }
+        for (const auto& aggregate : options.aggregates) {
+            aggregates.push_back(aggregateFactory.create_aggregate(aggregate, label));
+            query.observers.push_back(aggregates.back().get());
+        }
+        queries.push_back(std::move(query));
+    }
+
+    std::vector<std::string> inputs = expand_inputs(options.inputs);
+
+    ProcessorOptions processing;
+    processing.chunk_size = options.chunk_size;
+    processing.threads = options.threads;
+    processing.ordered = options.ordered;
+    PipelineStats stats;
+    if (!options.stats.empty()) {
+        processing.stats = &stats;
+    }
+
+    // Статичний конвеєр не інструментовано, тому --stats його вимикає.
+    bool handled = false;
+    if (options.follow) {
+        BasicNumberProcessor<T> processor(*reader, queries, processing);
+        processor.follow(options.inputs[0]);
+        handled = true;
+    } else if (queries.size() == 1 && inputs.size() == 1 && aggregates.empty() && processing.threads == 1 &&
+               !options.dynamic && !processing.stats) {
+        BasicNumberFilter<T>& filter = *filters[0];
+        BasicCountObserver<T>& countObserver = *countObservers[0];
+        if (printObservers.empty()) {
+            handled = run_static(*reader, filter, inputs[0], processing.chunk_size, countObserver);
+        } else {
+            visit_as<BasicPrintObserver<T>, BasicBufferedPrintObserver<T>>(*printObservers[0], [&](auto& printer) {
+                handled = run_static(*reader, filter, inputs[0], processing.chunk_size, printer, countObserver);
+            });
+        }
+    }
+    if (!handled) {
+        BasicNumberProcessor<T> processor(*reader, queries, processing);
+        processor.run(inputs);
+    }
+    if (processing.stats) {
+        write_stats(std::cerr, stats, options.filters, options.stats == "json");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    PipelineOptions options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << "Usage: ./number_pipeline [OPTIONS] <FILTER>... <FILENAME>" << std::endl;
+        std::cerr << "       ./number_pipeline [OPTIONS] --input=PATH... <FILTER>..." << std::endl;
+        std::cerr << "       ./number_pipeline [--reader=R] --convert[=raw|delta] <INPUT> <OUTPUT>" << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --chunk-size=N             values held in memory per chunk" << std::endl;
+        std::cerr << "  --reader=NAME              input reader: stream, fast, mmap, async or binary" << std::endl;
+        std::cerr << "  --type=int32|int64         value type (default int32)" << std::endl;
+        std::cerr << "  --threads=N                parse and filter on N threads" << std::endl;
+        std::cerr << "  --unordered                print results as chunks finish" << std::endl;
+        std::cerr << "  --dynamic                  always use the virtual-dispatch pipeline" << std::endl;
+        std::cerr << "  --buffered-output          print through a large buffer, flushed at the end" << std::endl;
+        std::cerr << "  --output-fd=N              write printed values to descriptor N (buffered)" << std::endl;
+        std::cerr << "  --count-only               print only the number of values that passed" << std::endl;
+        std::cerr << "  --input=PATH               input file or directory (repeatable)" << std::endl;
+        std::cerr << "  --follow                   keep watching <FILENAME> and process appended data" << std::endl;
+        std::cerr << "  --stats[=text|json]        print per-stage timings and counters to stderr" << std::endl;
+        std::cerr << "  --aggregate=LIST           also compute sum, minmax, distinct, top[:K]," << std::endl;
+        std::cerr << "                             histogram[:LO:HI:N] (comma-separated)" << std::endl;
+        std::cerr << "  --plugin=PATH              load filters from a shared library (repeatable)" << std::endl;
+        std::cerr << "  --convert[=raw|delta]      write <INPUT> to <OUTPUT> in the binary format" << std::endl;
+        std::cerr << "Example: ./number_pipeline EVEN numbers.txt" << std::endl;
+        return 1;
+    }
+
+    try {
+        if (!options.convert.empty()) {
+            ReaderFactory readers;
+            auto reader = readers.create_reader(options.reader);
+            BinaryWriterObserver writer(options.output,
+                                        options.convert == "delta" ? BlockEncoding::DELTA : BlockEncoding::RAW);
+            auto stream = reader->open_stream(options.inputs[0], options.chunk_size);
+            for (auto chunk = stream->next_chunk(); !chunk.empty(); chunk = stream->next_chunk()) {
+                writer.on_batch(chunk);
+            }
+            writer.on_finished();
+            std::cout << "Converted " << writer.written() << " numbers to " << options.output << std::endl;
+            return 0;
+        }
+
+        if (options.type == "int64") {
+            run_pipeline<std::int64_t>(options);
+        } else {
+            run_pipeline<int>(options);
+        }
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 2;
@@ -191,3 +3914,4 @@ int main(int argc, char* argv[]) {
 
     return 0;
 }
+#endif
@@ -0,0 +1,325 @@
+#define NUMBER_PIPELINE_NO_MAIN
+#include "number_pipeline.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// ===== Параметри бенчмарку =====
+
+struct BenchOptions {
+    std::size_t values = 10'000'000;
+    std::string distribution = "uniform";
+    unsigned repeat = 3;
+    unsigned threads = 0;
+    std::string report;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// ===== Синтетичні дані =====
+
+std::vector<int> generate_values(const BenchOptions& options) {
+    std::mt19937 rng(12345);
+    std::vector<int> values(options.values);
+
+    if (options.distribution == "uniform") {
+        std::uniform_int_distribution<int> dist(INT_MIN, INT_MAX);
+        for (auto& v : values) {
+            v = dist(rng);
+        }
+    } else if (options.distribution == "small") {
+        std::uniform_int_distribution<int> dist(0, 999);
+        for (auto& v : values) {
+            v = dist(rng);
+        }
+    } else if (options.distribution == "sorted") {
+        const double step = 4294967295.0 / static_cast<double>(values.size());
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<int>(static_cast<std::int64_t>(INT_MIN) + static_cast<std::int64_t>(step * i));
+        }
+    } else {
+        throw std::invalid_argument("Unknown distribution: " + options.distribution);
+    }
+
+    return values;
+}
+
+class TempFile {
+    std::string path;
+
+public:
+    explicit TempFile(const std::vector<int>& values) {
+        char name[] = "/tmp/number_pipeline_bench_XXXXXX";
+        int fd = ::mkstemp(name);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create temporary file");
+        }
+        FileDescriptor guard(fd);
+        path = name;
+
+        BufferedPrintObserver writer(fd);
+        writer.on_batch(values);
+        writer.on_finished();
+    }
+
+    ~TempFile() {
+        std::remove(path.c_str());
+    }
+
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    const std::string& name() const { return path; }
+
+    std::size_t size() const {
+        struct stat info;
+        return ::stat(path.c_str(), &info) == 0 ? static_cast<std::size_t>(info.st_size) : 0;
+    }
+};
+
+// ===== Вимірювання =====
+
+struct BenchResult {
+    std::string stage;
+    std::string name;
+    double seconds = 0;
+    double first_output_ms = 0;
+    std::size_t values = 0;
+    std::size_t bytes = 0;
+};
+
+// Запам'ятовує момент першого блоку, що дійшов до обсерверів.
+class FirstOutputObserver final : public INumberObserver {
+    Clock::time_point start;
+    std::size_t seen = 0;
+
+public:
+    double first_output_ms = -1;
+
+    explicit FirstOutputObserver(Clock::time_point s) : start(s) {}
+
+    void on_number(int) override {
+        on_batch({});
+    }
+
+    void on_batch(std::span<const int> numbers) override {
+        if (first_output_ms < 0) {
+            first_output_ms = seconds_since(start) * 1000;
+        }
+        seen += numbers.size();
+    }
+
+    void on_finished() override {}
+};
+
+// Найкращий з options.repeat прогонів.
+template <class Fn>
+BenchResult measure(const BenchOptions& options, const std::string& stage, const std::string& name, Fn&& fn) {
+    BenchResult best;
+    best.stage = stage;
+    best.name = name;
+    best.seconds = -1;
+
+    for (unsigned i = 0; i < options.repeat; ++i) {
+        BenchResult current;
+        current.stage = stage;
+        current.name = name;
+        auto start = Clock::now();
+        fn(current, start);
+        current.seconds = seconds_since(start);
+        if (best.seconds < 0 || current.seconds < best.seconds) {
+            best = current;
+        }
+    }
+
+    std::cerr << stage << "/" << name << ": " << best.seconds * 1000 << " ms" << std::endl;
+    return best;
+}
+
+std::vector<BenchResult> run_benchmarks(const BenchOptions& options) {
+    std::vector<int> values = generate_values(options);
+    TempFile file(values);
+    const std::size_t bytes = file.size();
+    FilterFactory filters;
+    ReaderFactory readers;
+
+    std::vector<std::string> filter_specs = { "EVEN", "ODD", "GT0", "EVEN&GT0&!GT1000000" };
+    std::vector<BenchResult> results;
+
+    for (const char* name : { "stream", "fast", "mmap" }) {
+        auto reader = readers.create_reader(name);
+        results.push_back(measure(options, "reader", name, [&](BenchResult& r, Clock::time_point start) {
+            auto stream = reader->open_stream(file.name(), kDefaultChunkSize);
+            for (auto chunk = stream->next_chunk(); !chunk.empty(); chunk = stream->next_chunk()) {
+                if (r.values == 0) {
+                    r.first_output_ms = seconds_since(start) * 1000;
+                }
+                r.values += chunk.size();
+            }
+            r.bytes = bytes;
+        }));
+    }
+
+    for (const auto& spec : filter_specs) {
+        auto filter = filters.create_filter(spec);
+        std::vector<int> selected(kDefaultChunkSize);
+        results.push_back(measure(options, "filter", spec, [&](BenchResult& r, Clock::time_point) {
+            std::size_t kept = 0;
+            for (std::size_t offset = 0; offset < values.size(); offset += kDefaultChunkSize) {
+                std::size_t n = std::min(kDefaultChunkSize, values.size() - offset);
+                kept += filter->keep_batch({values.data() + offset, n}, selected.data());
+            }
+            r.values = values.size();
+            if (kept > values.size()) {
+                throw std::logic_error("Filter kept more values than it received");
+            }
+        }));
+    }
+
+    // Ті самі фільтри над int64: множник непарний, тож парність зберігається,
+    // а значення виходять за межі int32.
+    BasicFilterFactory<std::int64_t> wide_filters;
+    std::vector<std::int64_t> wide_values(values.size());
+    std::transform(values.begin(), values.end(), wide_values.begin(),
+                   [](int v) { return static_cast<std::int64_t>(v) * 65537; });
+    for (const auto& spec : filter_specs) {
+        auto filter = wide_filters.create_filter(spec);
+        std::vector<std::int64_t> selected(kDefaultChunkSize);
+        results.push_back(measure(options, "filter", spec + "/int64", [&](BenchResult& r, Clock::time_point) {
+            std::size_t kept = 0;
+            for (std::size_t offset = 0; offset < wide_values.size(); offset += kDefaultChunkSize) {
+                std::size_t n = std::min(kDefaultChunkSize, wide_values.size() - offset);
+                kept += filter->keep_batch({wide_values.data() + offset, n}, selected.data());
+            }
+            r.values = wide_values.size();
+            if (kept > wide_values.size()) {
+                throw std::logic_error("Filter kept more values than it received");
+            }
+        }));
+    }
+
+    auto observe = [&](const std::string& name, auto make_observer) {
+        results.push_back(measure(options, "observer", name, [&](BenchResult& r, Clock::time_point) {
+            auto observer = make_observer();
+            for (std::size_t offset = 0; offset < values.size(); offset += kDefaultChunkSize) {
+                std::size_t n = std::min(kDefaultChunkSize, values.size() - offset);
+                observer->on_batch({values.data() + offset, n});
+            }
+            r.values = values.size();
+        }));
+    };
+
+    FileDescriptor null_fd(::open("/dev/null", O_WRONLY));
+    std::ofstream null_stream("/dev/null");
+    auto* cout_buffer = std::cout.rdbuf(null_stream.rdbuf());
+    observe("count", [] { return std::make_unique<CountObserver>(); });
+    observe("print", [] { return std::make_unique<PrintObserver>(); });
+    observe("buffered-print", [&] { return std::make_unique<BufferedPrintObserver>(null_fd.get()); });
+
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    for (const auto& spec : filter_specs) {
+        for (unsigned t : { 1u, threads }) {
+            auto reader = readers.create_reader("mmap");
+            auto filter = filters.create_filter(spec);
+            std::string name = spec + "/threads=" + std::to_string(t);
+            results.push_back(measure(options, "pipeline", name, [&](BenchResult& r, Clock::time_point start) {
+                CountObserver count;
+                FirstOutputObserver first(start);
+                ProcessorOptions processing;
+                processing.threads = t;
+                NumberProcessor processor(*reader, *filter, { &first, &count }, processing);
+                processor.run(file.name());
+                r.values = values.size();
+                r.bytes = bytes;
+                r.first_output_ms = first.first_output_ms;
+            }));
+            if (t == threads) {
+                break;
+            }
+        }
+    }
+    std::cout.rdbuf(cout_buffer);
+
+    return results;
+}
+
+// ===== Звіт =====
+
+void write_report(std::ostream& out, const BenchOptions& options, const std::vector<BenchResult>& results) {
+    out << "{\n";
+    out << "  \"values\": " << options.values << ",\n";
+    out << "  \"distribution\": \"" << options.distribution << "\",\n";
+    out << "  \"repeat\": " << options.repeat << ",\n";
+    out << "  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"stage\": \"" << r.stage << "\", \"name\": \"" << r.name << "\""
+            << ", \"seconds\": " << r.seconds
+            << ", \"values_per_sec\": " << (r.seconds > 0 ? r.values / r.seconds : 0);
+        if (r.bytes > 0) {
+            out << ", \"mb_per_sec\": " << (r.seconds > 0 ? r.bytes / r.seconds / 1e6 : 0);
+        }
+        if (r.stage == "reader" || r.stage == "pipeline") {
+            out << ", \"first_output_ms\": " << r.first_output_ms;
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+BenchOptions parse_bench_options(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--values=", 0) == 0) {
+            options.values = parse_size("--values", arg.substr(9));
+        } else if (arg.rfind("--distribution=", 0) == 0) {
+            options.distribution = arg.substr(15);
+        } else if (arg.rfind("--repeat=", 0) == 0) {
+            options.repeat = static_cast<unsigned>(parse_size("--repeat", arg.substr(9)));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            options.threads = static_cast<unsigned>(parse_size("--threads", arg.substr(10)));
+        } else if (arg.rfind("--report=", 0) == 0) {
+            options.report = arg.substr(9);
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    try {
+        options = parse_bench_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << "Usage: ./number_pipeline_bench [--values=N] [--distribution=uniform|sorted|small]"
+                  << " [--repeat=N] [--threads=N] [--report=FILE]" << std::endl;
+        return 1;
+    }
+
+    try {
+        auto results = run_benchmarks(options);
+        if (options.report.empty()) {
+            write_report(std::cout, options, results);
+        } else {
+            std::ofstream report(options.report);
+            if (!report) {
+                throw std::runtime_error("Cannot open report file: " + options.report);
+            }
+            write_report(report, options, results);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
@@ -4,36 +4,908 @@
 #include <string>
 #include <algorithm>
 #include <cctype>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum class LogLevel : std::uint8_t { TRACE, DEBUG, INFO, WARN, ERROR, OFF };
+
+// Мінімальний рівень, що потрапляє в бінарник: виклики LOG_* нижчих рівнів
+// відкидаються на етапі компіляції разом з обчисленням аргументів.
+// Наприклад, -DLOG_MIN_LEVEL=2 залишає лише INFO і вище.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+constexpr LogLevel kCompiledMinLevel = static_cast<LogLevel>(LOG_MIN_LEVEL);
 
 struct LogSink {
-    virtual void write(const std::string& msg) = 0;
+    virtual void write(std::string_view msg) = 0;
+    virtual void flush() {}
+    // true, якщо sink нічого не виводить: тоді Logger навіть не форматує повідомлення.
+    virtual bool discards() const { return false; }
+
+    // Sink'и, які повертають true, отримують замість тексту бінарні записи
+    // (encode_log_record), а форматування відкладається до декодування.
+    virtual bool wants_records() const { return false; }
+    // Запис, закодований для іншого sink'а, за замовчуванням форматується і
+    // передається у write().
+    virtual void write_record(std::string_view record);
+    // Текст, що дійшов до sink'а з wants_records() (буферизований до того, як
+    // цей sink додали): рівень зберігається, час — момент запису.
+    virtual void write_text(std::string_view msg, LogLevel) { write(msg); }
+
     virtual ~LogSink() = default;
 };
 
+struct SinkSettings {
+    std::string file_path = "app.log";
+    std::string binary_path = "app.bin";
+    std::string ring_path = "app.ring";
+    std::size_t ring_capacity = 4 * 1024 * 1024;
+    std::size_t file_buffer_bytes = 64 * 1024;
+    std::chrono::milliseconds file_flush_interval{1000};
+    bool console_buffered = false;
+    std::size_t console_buffer_bytes = 64 * 1024;
+};
+
+// Вимикає синхронізацію cout з stdio, щоб буферизований ConsoleSink не робив
+// виклик stdio на кожну операцію. Діє на весь процес: після цього вивід printf
+// і cout може перемежовуватися в іншому порядку. Викликати до першого виводу
+// в програмі (наприклад, на початку main); повторні виклики нічого не роблять.
+inline void unsync_console_from_stdio() {
+    static const bool unsynced = [] {
+        std::ios::sync_with_stdio(false);
+        return true;
+    }();
+    (void)unsynced;
+}
+
+// За замовчуванням кожен рядок одразу виводиться з std::endl. У буферизованому
+// режимі рядки накопичуються й виводяться одним cout.write, коли буфер більший
+// за console_buffer_bytes, за flush() (Logger скидає sink після повідомлень
+// рівня ERROR) і при знищенні sink'а на виході з програми. Синхронізацію з
+// stdio sink не чіпає: для цього є unsync_console_from_stdio().
 class ConsoleSink : public LogSink {
+    bool buffered_;
+    std::size_t buffer_limit_;
+    std::string buffer_;
+
 public:
-    void write(const std::string& msg) override {
-        std::cout << "[Console] " << msg << std::endl;
+    explicit ConsoleSink(const SinkSettings& settings = {})
+        : buffered_(settings.console_buffered), buffer_limit_(settings.console_buffer_bytes) {
+        if (buffered_) {
+            buffer_.reserve(buffer_limit_);
+        }
+    }
+
+    ~ConsoleSink() override {
+        flush();
+    }
+
+    void write(std::string_view msg) override {
+        if (!buffered_) {
+            std::cout << "[Console] " << msg << std::endl;
+            return;
+        }
+
+        buffer_ += "[Console] ";
+        buffer_ += msg;
+        buffer_ += '\n';
+        if (buffer_.size() >= buffer_limit_) {
+            flush();
+        }
+    }
+
+    void flush() override {
+        if (!buffer_.empty()) {
+            std::cout.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+        }
+        std::cout.flush();
     }
 };
 
+// Файл відкривається один раз; рядки накопичуються в буфері й скидаються,
+// коли він більший за file_buffer_bytes, за явним flush() і фоновим потоком
+// раз на file_flush_interval, тож рядок не лежить у буфері довше, навіть якщо
+// нових повідомлень немає. З нульовим інтервалом кожен рядок пишеться одразу.
 class FileSink : public LogSink {
+    std::ofstream file_;
+    std::string buffer_;
+    std::size_t buffer_limit_;
+    std::chrono::milliseconds flush_interval_;
+    // Logger серіалізує write()/flush(); mutex_ потрібен лише проти потоку скидання.
+    std::mutex mutex_;
+    std::condition_variable stop_changed_;
+    bool stop_ = false;
+    std::thread flusher_;
+
+    void flush_locked() {
+        if (!buffer_.empty()) {
+            file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+        }
+        file_.flush();
+    }
+
+    void flush_periodically() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_changed_.wait_for(lock, flush_interval_, [this] { return stop_; })) {
+            if (!buffer_.empty()) {
+                flush_locked();
+            }
+        }
+    }
+
 public:
-    void write(const std::string& msg) override {
-        std::ofstream file("app.log", std::ios::app);
-        if (file.is_open()) {
-            file << "[File] " << msg << std::endl;
+    explicit FileSink(const SinkSettings& settings = {})
+        : file_(settings.file_path, std::ios::app),
+          buffer_limit_(settings.file_buffer_bytes),
+          flush_interval_(settings.file_flush_interval) {
+        if (!file_.is_open()) {
+            throw std::runtime_error("Cannot open log file: " + settings.file_path);
+        }
+        buffer_.reserve(buffer_limit_);
+        if (flush_interval_.count() > 0) {
+            flusher_ = std::thread(&FileSink::flush_periodically, this);
         }
     }
+
+    ~FileSink() override {
+        if (flusher_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            stop_changed_.notify_one();
+            flusher_.join();
+        }
+        flush();
+    }
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    void write(std::string_view msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer_ += "[File] ";
+        buffer_ += msg;
+        buffer_ += '\n';
+
+        if (buffer_.size() >= buffer_limit_ || !flusher_.joinable()) {
+            flush_locked();
+        }
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flush_locked();
+    }
 };
 
 class NullSink : public LogSink {
 public:
-    void write(const std::string& msg) override {
+    void write(std::string_view) override {
+    }
+
+    void write_record(std::string_view) override {
+    }
+
+    bool discards() const override { return true; }
+};
+
+// Заголовок кільцевого файлу. head — скільки байтів записано за весь час,
+// тож позиція запису head % capacity, а після переповнення найстаріші дані
+// починаються саме там.
+struct RingHeader {
+    char magic[8];
+    std::uint64_t capacity;
+    std::uint64_t head;
+};
+
+constexpr std::string_view kRingLogMagic = "NLOGRNG1";
+constexpr std::size_t kRingHeaderSize = 64;
+
+// Пише рядки у відображений у пам'ять файл фіксованого розміру як у кільцевий
+// буфер: запис — це memcpy без системних викликів, а сторінки залишаються в
+// page cache після падіння процесу, тож останні capacity байтів журналу можна
+// прочитати (./log_decode app.ring). Існуючий файл з тим самим розміром
+// продовжується з місця зупинки.
+class MmapRingSink : public LogSink {
+    char* map_ = nullptr;
+    std::size_t map_size_ = 0;
+    RingHeader* header_ = nullptr;
+    char* data_ = nullptr;
+    std::size_t capacity_ = 0;
+
+    void put(const char* bytes, std::size_t size) {
+        if (size > capacity_) {
+            bytes += size - capacity_;
+            size = capacity_;
+        }
+        std::uint64_t head = header_->head;
+        std::size_t pos = static_cast<std::size_t>(head % capacity_);
+        std::size_t first = std::min(size, capacity_ - pos);
+        std::memcpy(data_ + pos, bytes, first);
+        std::memcpy(data_, bytes + first, size - first);
+        // head оновлюється після даних, щоб після падіння не вказувати на незаписане.
+        std::atomic_ref<std::uint64_t>(header_->head).store(head + size, std::memory_order_release);
+    }
+
+public:
+    explicit MmapRingSink(const SinkSettings& settings = {}) : capacity_(settings.ring_capacity) {
+        if (capacity_ == 0) {
+            throw std::invalid_argument("Ring capacity must be greater than 0");
+        }
+        int fd = ::open(settings.ring_path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open log file: " + settings.ring_path);
+        }
+
+        map_size_ = kRingHeaderSize + capacity_;
+        struct stat info;
+        bool resized = ::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) != map_size_;
+        if (resized && ::ftruncate(fd, static_cast<off_t>(map_size_)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot resize log file: " + settings.ring_path);
+        }
+        void* map = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            throw std::runtime_error("Cannot map log file: " + settings.ring_path);
+        }
+
+        map_ = static_cast<char*>(map);
+        header_ = reinterpret_cast<RingHeader*>(map_);
+        data_ = map_ + kRingHeaderSize;
+        if (resized || std::string_view(header_->magic, 8) != kRingLogMagic || header_->capacity != capacity_) {
+            std::memset(map_, 0, kRingHeaderSize);
+            std::memcpy(header_->magic, kRingLogMagic.data(), kRingLogMagic.size());
+            header_->capacity = capacity_;
+        }
+    }
+
+    ~MmapRingSink() override {
+        flush();
+        ::munmap(map_, map_size_);
+    }
+
+    MmapRingSink(const MmapRingSink&) = delete;
+    MmapRingSink& operator=(const MmapRingSink&) = delete;
+
+    void write(std::string_view msg) override {
+        constexpr std::string_view prefix = "[Mmap] ";
+        put(prefix.data(), prefix.size());
+        put(msg.data(), msg.size());
+        put("\n", 1);
+    }
+
+    // Дані вже в page cache; msync лише просить ядро записати їх на диск.
+    void flush() override {
+        ::msync(map_, map_size_, MS_ASYNC);
+    }
+};
+
+// Відновлює текст із кільцевого файлу: від найстарішого цілого рядка до head.
+inline std::string read_ring_log(std::string_view file) {
+    if (file.size() < kRingHeaderSize || file.substr(0, kRingLogMagic.size()) != kRingLogMagic) {
+        throw std::runtime_error("Not a ring log");
+    }
+    RingHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    std::string_view data = file.substr(kRingHeaderSize);
+    if (header.capacity == 0 || data.size() < header.capacity) {
+        throw std::runtime_error("Truncated ring log");
+    }
+
+    if (header.head <= header.capacity) {
+        return std::string(data.substr(0, static_cast<std::size_t>(header.head)));
+    }
+    std::size_t pos = static_cast<std::size_t>(header.head % header.capacity);
+    std::string text;
+    text.reserve(header.capacity);
+    text.append(data.substr(pos, header.capacity - pos));
+    text.append(data.substr(0, pos));
+    // Перший рядок після переповнення зазвичай обрізаний.
+    std::size_t newline = text.find('\n');
+    text.erase(0, newline == std::string::npos ? text.size() : newline + 1);
+    return text;
+}
+
+// Аргумент повідомлення без власної пам'яті: числа зберігаються за значенням,
+// рядки — як view на пам'ять викликача.
+struct LogArg {
+    enum class Type : std::uint8_t { INT, UINT, DOUBLE, BOOL, CHAR, STRING };
+
+    Type type;
+    union {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+        bool b;
+        char c;
+    };
+    std::string_view s;
+};
+
+template <class T>
+LogArg make_log_arg(const T& value) {
+    using U = std::decay_t<T>;
+    LogArg arg{};
+    if constexpr (std::is_same_v<U, bool>) {
+        arg.type = LogArg::Type::BOOL;
+        arg.b = value;
+    } else if constexpr (std::is_same_v<U, char>) {
+        arg.type = LogArg::Type::CHAR;
+        arg.c = value;
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        arg.type = LogArg::Type::INT;
+        arg.i = value;
+    } else if constexpr (std::is_integral_v<U>) {
+        arg.type = LogArg::Type::UINT;
+        arg.u = value;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        arg.type = LogArg::Type::DOUBLE;
+        arg.d = value;
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        arg.type = LogArg::Type::STRING;
+        arg.s = std::string_view(value);
+    } else {
+        static_assert(std::is_convertible_v<const T&, std::string_view>, "Unsupported log argument type");
+    }
+    return arg;
+}
+
+// Кількість підстановок {} у форматі; {{ і }} — екрановані дужки.
+// Повертає -1 для непарної дужки.
+constexpr int count_placeholders(std::string_view fmt) {
+    int count = 0;
+    for (std::size_t i = 0; i < fmt.size(); ++i) {
+        if (fmt[i] == '{') {
+            if (i + 1 < fmt.size() && fmt[i + 1] == '{') {
+                ++i;
+            } else if (i + 1 < fmt.size() && fmt[i + 1] == '}') {
+                ++count;
+                ++i;
+            } else {
+                return -1;
+            }
+        } else if (fmt[i] == '}') {
+            if (i + 1 < fmt.size() && fmt[i + 1] == '}') {
+                ++i;
+            } else {
+                return -1;
+            }
+        }
+    }
+    return count;
+}
+
+// Рядок формату, перевірений під час компіляції: кількість {} має збігатися
+// з кількістю аргументів, інакше consteval-конструктор не скомпілюється.
+template <class... Args>
+struct FormatString {
+    std::string_view text;
+
+    template <std::size_t N>
+    consteval FormatString(const char (&fmt)[N]) : text(fmt, N - 1) {
+        if (count_placeholders(text) != static_cast<int>(sizeof...(Args))) {
+            throw "log format does not match the number of arguments";
+        }
+    }
+};
+
+// Форматує fmt з args у [out, out + capacity) і повертає довжину результату.
+// Те, що не вміщається, обрізається.
+inline std::size_t format_log_message(char* out, std::size_t capacity, std::string_view fmt,
+                                      const LogArg* args, std::size_t arg_count) {
+    char* p = out;
+    char* end = out + capacity;
+    auto put = [&](std::string_view text) {
+        std::size_t n = std::min(text.size(), static_cast<std::size_t>(end - p));
+        std::copy_n(text.data(), n, p);
+        p += n;
+    };
+
+    std::size_t next_arg = 0;
+    for (std::size_t i = 0; i < fmt.size(); ++i) {
+        char ch = fmt[i];
+        if ((ch == '{' || ch == '}') && i + 1 < fmt.size() && fmt[i + 1] == ch) {
+            put({&fmt[i], 1});
+            ++i;
+            continue;
+        }
+        if (ch != '{' || i + 1 >= fmt.size() || fmt[i + 1] != '}' || next_arg >= arg_count) {
+            put({&fmt[i], 1});
+            continue;
+        }
+        ++i;
+
+        const LogArg& arg = args[next_arg++];
+        char digits[32];
+        std::to_chars_result r{digits, std::errc()};
+        switch (arg.type) {
+            case LogArg::Type::INT:    r = std::to_chars(digits, digits + sizeof(digits), arg.i); break;
+            case LogArg::Type::UINT:   r = std::to_chars(digits, digits + sizeof(digits), arg.u); break;
+            case LogArg::Type::DOUBLE: r = std::to_chars(digits, digits + sizeof(digits), arg.d); break;
+            case LogArg::Type::BOOL:   put(arg.b ? "true" : "false"); break;
+            case LogArg::Type::CHAR:   put({&arg.c, 1}); break;
+            case LogArg::Type::STRING: put(arg.s); break;
+        }
+        put({digits, static_cast<std::size_t>(r.ptr - digits)});
+    }
+
+    return static_cast<std::size_t>(p - out);
+}
+
+// Бінарний запис: u32 id формату, u8 рівень, u64 час (нс від епохи), u8 кількість
+// аргументів, далі для кожного u8 тип і значення (8 байтів для чисел, 1 для
+// bool/char, u32 довжина + байти для рядків). Порядок байтів — рідний для
+// машини, бо записи читає декодер на тій самій платформі.
+inline std::size_t encode_log_record(char* out, std::size_t capacity, std::uint32_t format_id, LogLevel level,
+                                     std::uint64_t timestamp, const LogArg* args, std::size_t arg_count) {
+    char* p = out;
+    char* end = out + capacity;
+    auto put = [&](const void* data, std::size_t size) {
+        if (static_cast<std::size_t>(end - p) < size) {
+            return false;
+        }
+        std::memcpy(p, data, size);
+        p += size;
+        return true;
+    };
+
+    auto level_byte = static_cast<std::uint8_t>(level);
+    auto count = static_cast<std::uint8_t>(std::min<std::size_t>(arg_count, 255));
+    put(&format_id, 4);
+    put(&level_byte, 1);
+    put(&timestamp, 8);
+    char* count_pos = p;
+    put(&count, 1);
+
+    std::uint8_t written = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const LogArg& arg = args[i];
+        char* start = p;
+        auto type = static_cast<std::uint8_t>(arg.type);
+        bool ok = put(&type, 1);
+        switch (arg.type) {
+            case LogArg::Type::INT:    ok = ok && put(&arg.i, 8); break;
+            case LogArg::Type::UINT:   ok = ok && put(&arg.u, 8); break;
+            case LogArg::Type::DOUBLE: ok = ok && put(&arg.d, 8); break;
+            case LogArg::Type::BOOL:   ok = ok && put(&arg.b, 1); break;
+            case LogArg::Type::CHAR:   ok = ok && put(&arg.c, 1); break;
+            case LogArg::Type::STRING: {
+                std::size_t room = end - p > 5 ? static_cast<std::size_t>(end - p) - 5 : 0;
+                auto size = static_cast<std::uint32_t>(std::min(arg.s.size(), room));
+                ok = ok && put(&size, 4) && put(arg.s.data(), size);
+                break;
+            }
+        }
+        if (!ok) {
+            p = start;
+            break;
+        }
+        ++written;
+    }
+    std::memcpy(count_pos, &written, 1);
+
+    return static_cast<std::size_t>(p - out);
+}
+
+struct DecodedRecord {
+    std::uint32_t format_id = 0;
+    LogLevel level = LogLevel::INFO;
+    std::uint64_t timestamp = 0;
+    std::vector<LogArg> args;
+};
+
+// Рядкові аргументи вказують у record, тож він має жити довше за результат.
+inline bool decode_log_record(std::string_view record, DecodedRecord& out) {
+    const char* p = record.data();
+    const char* end = p + record.size();
+    auto get = [&](void* data, std::size_t size) {
+        if (static_cast<std::size_t>(end - p) < size) {
+            return false;
+        }
+        std::memcpy(data, p, size);
+        p += size;
+        return true;
+    };
+
+    std::uint8_t level = 0;
+    std::uint8_t count = 0;
+    if (!get(&out.format_id, 4) || !get(&level, 1) || !get(&out.timestamp, 8) || !get(&count, 1)) {
+        return false;
+    }
+    out.level = static_cast<LogLevel>(level);
+    out.args.clear();
+
+    for (std::uint8_t i = 0; i < count; ++i) {
+        LogArg arg{};
+        std::uint8_t type = 0;
+        if (!get(&type, 1)) {
+            return false;
+        }
+        arg.type = static_cast<LogArg::Type>(type);
+        bool ok = true;
+        switch (arg.type) {
+            case LogArg::Type::INT:    ok = get(&arg.i, 8); break;
+            case LogArg::Type::UINT:   ok = get(&arg.u, 8); break;
+            case LogArg::Type::DOUBLE: ok = get(&arg.d, 8); break;
+            case LogArg::Type::BOOL:   ok = get(&arg.b, 1); break;
+            case LogArg::Type::CHAR:   ok = get(&arg.c, 1); break;
+            case LogArg::Type::STRING: {
+                std::uint32_t size = 0;
+                ok = get(&size, 4) && static_cast<std::size_t>(end - p) >= size;
+                if (ok) {
+                    arg.s = std::string_view(p, size);
+                    p += size;
+                }
+                break;
+            }
+            default: ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+        out.args.push_back(arg);
+    }
+    return true;
+}
+
+// Глобальна таблиця форматів для бінарних записів. Формати — рядкові літерали,
+// тому ключем є адреса, а кожен потік кешує знайдені id у thread_local map.
+class FormatRegistry {
+    std::mutex mutex_;
+    std::unordered_map<const char*, std::uint32_t> ids_;
+    std::vector<std::string_view> formats_;
+
+public:
+    static FormatRegistry& instance() {
+        static FormatRegistry registry;
+        return registry;
+    }
+
+    std::uint32_t id(std::string_view format) {
+        thread_local std::unordered_map<const char*, std::uint32_t> cache;
+        auto cached = cache.find(format.data());
+        if (cached != cache.end()) {
+            return cached->second;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto [it, inserted] = ids_.try_emplace(format.data(), static_cast<std::uint32_t>(formats_.size()));
+        if (inserted) {
+            formats_.push_back(format);
+        }
+        cache.emplace(format.data(), it->second);
+        return it->second;
+    }
+
+    std::string_view format(std::uint32_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return id < formats_.size() ? formats_[id] : std::string_view("{}");
+    }
+};
+
+inline std::uint64_t log_timestamp() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Форматує запис у thread_local буфер; false для пошкодженого запису.
+inline bool format_log_record(std::string_view record, std::string_view& out) {
+    thread_local DecodedRecord decoded;
+    thread_local std::array<char, 4096> text;
+    if (!decode_log_record(record, decoded)) {
+        return false;
+    }
+    std::string_view format = FormatRegistry::instance().format(decoded.format_id);
+    std::size_t size = format_log_message(text.data(), text.size(), format,
+                                          decoded.args.data(), decoded.args.size());
+    out = std::string_view(text.data(), size);
+    return true;
+}
+
+inline void LogSink::write_record(std::string_view record) {
+    std::string_view text;
+    if (format_log_record(record, text)) {
+        write(text);
+    }
+}
+
+// Файл бінарного журналу починається з kBinaryLogMagic, далі йдуть елементи:
+//   'F' u32 id, u32 довжина, текст формату — визначення формату перед першим
+//       записом з ним (після перезапуску процесу визначення повторюються);
+//   'R' u32 довжина, запис encode_log_record.
+constexpr std::string_view kBinaryLogMagic = "NLOGBIN1";
+
+// Записує формат один раз, а далі лише id і сирі байти аргументів: вартість
+// виклику — memcpy, текст відновлює декодер log_decode.
+class BinarySink : public LogSink {
+    std::ofstream file_;
+    std::string buffer_;
+    std::size_t buffer_limit_;
+    std::vector<bool> defined_;
+
+    template <class T>
+    void append(const T& value) {
+        buffer_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+public:
+    explicit BinarySink(const SinkSettings& settings = {})
+        : file_(settings.binary_path, std::ios::app | std::ios::binary),
+          buffer_limit_(settings.file_buffer_bytes) {
+        if (!file_.is_open()) {
+            throw std::runtime_error("Cannot open log file: " + settings.binary_path);
+        }
+        if (file_.tellp() == 0) {
+            buffer_.append(kBinaryLogMagic);
+        }
+        buffer_.reserve(buffer_limit_);
+    }
+
+    ~BinarySink() override {
+        flush();
+    }
+
+    bool wants_records() const override { return true; }
+
+    void write(std::string_view msg) override {
+        write_text(msg, LogLevel::INFO);
+    }
+
+    void write_text(std::string_view msg, LogLevel level) override {
+        thread_local std::array<char, 4096> record;
+        LogArg arg{};
+        arg.type = LogArg::Type::STRING;
+        arg.s = msg;
+        std::size_t size = encode_log_record(record.data(), record.size(), FormatRegistry::instance().id("{}"),
+                                             level, log_timestamp(), &arg, 1);
+        write_record(std::string_view(record.data(), size));
+    }
+
+    void write_record(std::string_view record) override {
+        std::uint32_t id = 0;
+        if (record.size() < sizeof(id)) {
+            return;
+        }
+        std::memcpy(&id, record.data(), sizeof(id));
+
+        if (id >= defined_.size() || !defined_[id]) {
+            std::string_view format = FormatRegistry::instance().format(id);
+            buffer_ += 'F';
+            append(id);
+            append(static_cast<std::uint32_t>(format.size()));
+            buffer_ += format;
+            if (id >= defined_.size()) {
+                defined_.resize(id + 1);
+            }
+            defined_[id] = true;
+        }
+
+        buffer_ += 'R';
+        append(static_cast<std::uint32_t>(record.size()));
+        buffer_ += record;
+
+        if (buffer_.size() >= buffer_limit_) {
+            flush();
+        }
+    }
+
+    void flush() override {
+        if (!buffer_.empty()) {
+            file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+        }
+        file_.flush();
+    }
+};
+
+enum class SinkType { CONSOLE, FILE, NONE, BINARY, MMAP };
+
+// Повідомлення на шляху до sink'а: текст або бінарний запис (record == true).
+struct LogEntry {
+    LogLevel level = LogLevel::INFO;
+    bool record = false;
+    std::string data;
+};
+
+// Помилки не залишаються в буферах sink'а: після ERROR sink одразу скидається.
+inline void deliver(LogSink& sink, const LogEntry& entry) {
+    if (entry.record) {
+        sink.write_record(entry.data);
+    } else {
+        sink.write_text(entry.data, entry.level);
+    }
+    if (entry.level >= LogLevel::ERROR) {
+        sink.flush();
+    }
+}
+
+// Що робити, коли асинхронна черга заповнена.
+enum class OverflowPolicy { BLOCK, DROP_NEWEST, DROP_OLDEST };
+
+// Обмежена lock-free черга Дмитра Вюкова: кожна комірка має лічильник
+// послідовності, тож ні виробники, ні споживач не беруть м'ютексів. Черга
+// коректна і для кількох споживачів — цим користується DROP_OLDEST, коли
+// виробник сам викидає найстаріше повідомлення.
+class LogQueue {
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        LogEntry entry;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_;
+    alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+
+public:
+    explicit LogQueue(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        cells_ = std::make_unique<Cell[]>(size);
+        mask_ = size - 1;
+        for (std::size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(LogLevel level, bool record, std::string_view data) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    // Рядок у комірці перевикористовує свою ємність, тож після
+                    // прогріву запис не виділяє пам'ять.
+                    cell.entry.level = level;
+                    cell.entry.record = record;
+                    cell.entry.data.assign(data);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(LogEntry& out) {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out.level = cell.entry.level;
+                    out.record = cell.entry.record;
+                    out.data.swap(cell.entry.data);
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
     }
 };
 
-enum class SinkType { CONSOLE, FILE, NONE };
+// Активні sink'и разом з м'ютексом, що серіалізує записи в них. Logger
+// тримає слот в atomic<shared_ptr>: set_sink()/add_sink() лише публікують
+// новий слот, а старий знищується, коли його відпустить останній потік, що в
+// нього пише. Усі версії слоту ділять один write_mutex, тож потік, що ще
+// пише у старий слот, і потік з новим не зливають буфери одночасно, а старий
+// і новий слоти не пишуть в один sink одночасно. add_sink() переносить у
+// новий слот і наявні sink'и.
+struct SinkSlot {
+    struct Target {
+        std::shared_ptr<LogSink> sink;
+        LogLevel level = LogLevel::TRACE;
+    };
+
+    std::vector<Target> targets;
+    std::shared_ptr<std::mutex> write_mutex = std::make_shared<std::mutex>();
+
+    void flush() {
+        for (auto& target : targets) {
+            target.sink->flush();
+        }
+    }
+};
+
+// Повідомлення форматується один раз, і той самий текст (чи запис) отримує
+// кожен sink, чий поріг воно проходить. Запис форматується для текстових
+// sink'ів тут, при першому з них.
+inline void deliver(const SinkSlot& slot, const LogEntry& entry) {
+    std::string_view text;
+    bool formatted = false;
+    bool format_failed = false;
+    for (const auto& target : slot.targets) {
+        if (entry.level < target.level) {
+            continue;
+        }
+        LogSink& sink = *target.sink;
+        if (!entry.record || sink.wants_records()) {
+            deliver(sink, entry);
+            continue;
+        }
+        if (sink.discards()) {
+            continue;
+        }
+        if (format_failed) {
+            continue;
+        }
+        if (!formatted) {
+            // Пошкоджений запис пропускають лише текстові sink'и; ті, що
+            // приймають записи, отримують його далі по targets.
+            if (!format_log_record(entry.data, text)) {
+                format_failed = true;
+                continue;
+            }
+            formatted = true;
+        }
+        sink.write(text);
+        if (entry.level >= LogLevel::ERROR) {
+            sink.flush();
+        }
+    }
+}
+
+// Повідомлення потоку, які ще не потрапили в sink. Рядки перевикористовуються,
+// тож після прогріву буферизація не виділяє пам'ять.
+struct ThreadBuffer {
+    std::mutex mutex;
+    std::vector<LogEntry> entries;
+    std::size_t count = 0;
+
+    void append(LogLevel level, bool record, std::string_view data) {
+        if (count == entries.size()) {
+            entries.emplace_back();
+        }
+        LogEntry& entry = entries[count++];
+        entry.level = level;
+        entry.record = record;
+        entry.data.assign(data);
+    }
+
+    void drain_to(const SinkSlot& slot) {
+        for (std::size_t i = 0; i < count; ++i) {
+            deliver(slot, entries[i]);
+        }
+        count = 0;
+    }
+};
 
 class Logger {
 public:
@@ -42,72 +914,534 @@ public:
         return instance;
     }
 
-    void set_sink(SinkType type) {
+    // Налаштування застосовуються до sink'ів, створених наступними set_sink().
+    void configure(const SinkSettings& settings) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        settings_ = settings;
+    }
+
+    // Замінює всі sink'и одним.
+    void set_sink(SinkType type, LogLevel level = LogLevel::TRACE) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        auto slot = std::make_shared<SinkSlot>();
+        if (auto current = slot_.load()) {
+            slot->write_mutex = current->write_mutex;
+        }
+        slot->targets.push_back({ make_sink(type), level });
+        publish(std::move(slot));
+    }
+
+    // Додає ще один sink до наявних; він отримує лише повідомлення рівня
+    // level і вище (поверх загального порогу set_level).
+    void add_sink(SinkType type, LogLevel level = LogLevel::TRACE) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        auto current = slot_.load();
+        auto slot = std::make_shared<SinkSlot>();
+        slot->targets = current->targets;
+        slot->write_mutex = current->write_mutex;
+        slot->targets.push_back({ make_sink(type), level });
+        publish(std::move(slot));
+    }
+
+    void set_level(LogLevel level) {
+        level_.store(level, std::memory_order_relaxed);
+    }
+
+    LogLevel level() const {
+        return level_.load(std::memory_order_relaxed);
+    }
+
+    // Дешева перевірка перед будь-якою роботою з повідомленням.
+    bool enabled(LogLevel level) const {
+        return level >= kCompiledMinLevel && level >= level_.load(std::memory_order_relaxed) &&
+               level >= sink_floor_.load(std::memory_order_relaxed) &&
+               level != LogLevel::OFF && !discard_.load(std::memory_order_relaxed);
+    }
+
+    // Потокобезпечний. Повідомлення спершу йде в буфер потоку; якщо sink
+    // вільний, буфер одразу зливається в нього, інакше потік не чекає, а
+    // повідомлення запише потік, що зараз тримає sink, перед тим як його відпустити.
+    void log(LogLevel level, std::string_view msg) {
+        if (!enabled(level)) {
+            return;
+        }
+        if (records_.load(std::memory_order_relaxed)) {
+            LogArg arg{};
+            arg.type = LogArg::Type::STRING;
+            arg.s = msg;
+            dispatch_record(level, "{}", &arg, 1);
+        } else {
+            dispatch(level, false, msg);
+        }
+    }
+
+    void log(std::string_view msg) {
+        log(LogLevel::INFO, msg);
+    }
+
+    // log(level, "x = {}, y = {}", x, y): формат перевіряється під час компіляції,
+    // повідомлення складається в thread_local буфері без виділення пам'яті,
+    // а якщо рівень вимкнено чи поточний sink нічого не виводить, форматування
+    // не виконується. Для бінарного sink'а замість тексту пишеться запис з id
+    // формату і сирими аргументами.
+    template <class... Args>
+    void log(LogLevel level, FormatString<std::type_identity_t<Args>...> fmt, const Args&... args) {
+        if (!enabled(level)) {
+            return;
+        }
+
+        std::array<LogArg, sizeof...(Args)> packed{make_log_arg(args)...};
+        if (records_.load(std::memory_order_relaxed)) {
+            dispatch_record(level, fmt.text, packed.data(), packed.size());
+            return;
+        }
+
+        thread_local std::array<char, kMaxMessage> buffer;
+        std::size_t size = format_log_message(buffer.data(), buffer.size(), fmt.text,
+                                              packed.data(), packed.size());
+        dispatch(level, false, std::string_view(buffer.data(), size));
+    }
+
+    template <class... Args>
+    void log(FormatString<std::type_identity_t<Args>...> fmt, const Args&... args) {
+        log(LogLevel::INFO, fmt, args...);
+    }
+
+    // В асинхронному режимі log() лише кладе повідомлення в lock-free чергу,
+    // а запис у sink виконує окремий фоновий потік.
+    void set_async(bool enabled, std::size_t capacity = 8192,
+                   OverflowPolicy policy = OverflowPolicy::BLOCK) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        stop_async();
+        if (enabled) {
+            async_.store(std::make_shared<AsyncState>(*this, capacity, policy));
+        }
+    }
+
+    // Повертає, коли все, що вже прийняли черга та буфери потоків, записано
+    // в sink і sink скинув свої буфери.
+    void flush() {
+        if (auto async = async_.load()) {
+            async->wait_written();
+        }
+
+        auto slot = slot_.load();
+        {
+            std::lock_guard<std::mutex> write_lock(*slot->write_mutex);
+            pending_.store(false);
+            drain_all(*slot);
+            slot->flush();
+        }
+        drain_pending(*slot);
+    }
+
+    std::uint64_t dropped_messages() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    ~Logger() {
+        stop_async();
+    }
+
+private:
+    static constexpr std::size_t kMaxThreadBuffered = 256;
+    static constexpr std::size_t kMaxMessage = 4096;
+
+    class AsyncState {
+        Logger& logger_;
+        LogQueue queue_;
+        OverflowPolicy policy_;
+        std::atomic<bool> running_{true};
+        std::atomic<std::uint64_t> pushed_{0};
+        std::atomic<std::uint64_t> done_{0};
+        std::thread worker_;
+
+        void drain() {
+            LogEntry entry;
+            while (true) {
+                std::uint64_t seen = pushed_.load();
+                std::uint64_t wrote = 0;
+                if (queue_.try_pop(entry)) {
+                    auto slot = logger_.slot_.load();
+                    {
+                        std::lock_guard<std::mutex> lock(*slot->write_mutex);
+                        do {
+                            deliver(*slot, entry);
+                            ++wrote;
+                        } while (wrote < 1024 && queue_.try_pop(entry));
+                    }
+                    logger_.drain_pending(*slot);
+                }
+                if (wrote > 0) {
+                    done_.fetch_add(wrote);
+                    done_.notify_all();
+                } else if (!running_) {
+                    return;
+                } else {
+                    pushed_.wait(seen);
+                }
+            }
+        }
+
+    public:
+        AsyncState(Logger& logger, std::size_t capacity, OverflowPolicy policy)
+            : logger_(logger), queue_(capacity), policy_(policy), worker_([this] { drain(); }) {}
+
+        void enqueue(LogLevel level, bool record, std::string_view data) {
+            while (!queue_.try_push(level, record, data)) {
+                if (policy_ == OverflowPolicy::DROP_NEWEST) {
+                    logger_.dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                if (policy_ == OverflowPolicy::DROP_OLDEST) {
+                    thread_local LogEntry discarded;
+                    if (queue_.try_pop(discarded)) {
+                        logger_.dropped_.fetch_add(1, std::memory_order_relaxed);
+                        done_.fetch_add(1);
+                        done_.notify_all();
+                    }
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            pushed_.fetch_add(1);
+            pushed_.notify_one();
+        }
+
+        void wait_written() {
+            std::uint64_t target = pushed_.load();
+            std::uint64_t current = done_.load();
+            while (current < target) {
+                done_.wait(current);
+                current = done_.load();
+            }
+        }
+
+        // Викликається, коли стан уже знято з async_; self — останнє посилання
+        // Logger'а. Потоки, що встигли його взяти, ще можуть дописувати в чергу,
+        // тому залишок дочитується лише після того, як вони всі його відпустять.
+        static void stop(std::shared_ptr<AsyncState> self) {
+            self->running_ = false;
+            self->pushed_.fetch_add(1);
+            self->pushed_.notify_one();
+            self->worker_.join();
+
+            while (self.use_count() > 1) {
+                std::this_thread::yield();
+            }
+            LogEntry entry;
+            auto slot = self->logger_.slot_.load();
+            {
+                std::lock_guard<std::mutex> lock(*slot->write_mutex);
+                while (self->queue_.try_pop(entry)) {
+                    deliver(*slot, entry);
+                }
+            }
+            self->logger_.drain_pending(*slot);
+        }
+    };
+
+    // Реєструє буфер потоку в Logger'і, щоб flush() міг до нього дістатися,
+    // і зливає залишок у sink, коли потік завершується.
+    class ThreadBufferHolder {
+        Logger& logger_;
+        ThreadBuffer buffer_;
+
+    public:
+        explicit ThreadBufferHolder(Logger& logger) : logger_(logger) {
+            std::lock_guard<std::mutex> lock(logger_.registry_mutex_);
+            logger_.buffers_.push_back(&buffer_);
+        }
+
+        ~ThreadBufferHolder() {
+            {
+                std::lock_guard<std::mutex> lock(logger_.registry_mutex_);
+                auto& buffers = logger_.buffers_;
+                buffers.erase(std::find(buffers.begin(), buffers.end(), &buffer_));
+            }
+            auto slot = logger_.slot_.load();
+            {
+                std::lock_guard<std::mutex> write_lock(*slot->write_mutex);
+                std::lock_guard<std::mutex> lock(buffer_.mutex);
+                buffer_.drain_to(*slot);
+            }
+            logger_.drain_pending(*slot);
+        }
+
+        ThreadBuffer& get() { return buffer_; }
+    };
+
+    std::atomic<std::shared_ptr<SinkSlot>> slot_;
+    std::atomic<std::shared_ptr<AsyncState>> async_;
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<bool> discard_{false};
+    std::atomic<bool> records_{false};
+    // Якомусь потоку не вдалося захопити sink, і його повідомлення чекають у буфері.
+    std::atomic<bool> pending_{false};
+    std::atomic<LogLevel> sink_floor_{LogLevel::TRACE};
+    std::atomic<LogLevel> level_{LogLevel::INFO};
+
+    std::mutex config_mutex_;
+    SinkSettings settings_;
+
+    // Порядок захоплення: write_mutex слоту, registry_mutex_, м'ютекс буфера.
+    // Власник буфера тримає свій м'ютекс лише на час append(), нічого не чекаючи.
+    std::mutex registry_mutex_;
+    std::vector<ThreadBuffer*> buffers_;
+
+    Logger() {
+        set_sink(SinkType::CONSOLE);
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Викликається під config_mutex_.
+    std::unique_ptr<LogSink> make_sink(SinkType type) {
         switch (type) {
             case SinkType::CONSOLE:
-                sink_ = std::make_unique<ConsoleSink>();
                 std::cout << "Log sink set to CONSOLE.\n";
-                break;
+                return std::make_unique<ConsoleSink>(settings_);
             case SinkType::FILE:
-                sink_ = std::make_unique<FileSink>();
                 std::cout << "Log sink set to FILE.\n";
-                break;
+                return std::make_unique<FileSink>(settings_);
             case SinkType::NONE:
-                sink_ = std::make_unique<NullSink>();
                 std::cout << "Log sink set to NONE (no output).\n";
-                break;
+                return std::make_unique<NullSink>();
+            case SinkType::BINARY:
+                std::cout << "Log sink set to BINARY.\n";
+                return std::make_unique<BinarySink>(settings_);
+            case SinkType::MMAP:
+                std::cout << "Log sink set to MMAP.\n";
+                return std::make_unique<MmapRingSink>(settings_);
         }
+        throw std::invalid_argument("Unknown sink type");
     }
 
-    void log(const std::string& msg) {
-        if (sink_) {
-            sink_->write(msg);
+    // Прапорці для швидкого шляху рахуються за всіма sink'ами слоту: форматування
+    // пропускається, лише якщо всі sink'и відкидають вивід, записи замість тексту
+    // будуються, якщо їх приймає хоч один sink (тоді рівень і час виклику
+    // зберігаються, а текстові sink'и отримують запис, відформатований при
+    // доставці), а рівень нижче за поріг кожного sink'а відсікається одразу.
+    void publish(std::shared_ptr<SinkSlot> slot) {
+        bool discards = true;
+        bool records = false;
+        LogLevel floor = LogLevel::OFF;
+        for (const auto& target : slot->targets) {
+            discards = discards && target.sink->discards();
+            records = records || target.sink->wants_records();
+            floor = std::min(floor, target.level);
         }
+        discard_.store(discards, std::memory_order_relaxed);
+        records_.store(records, std::memory_order_relaxed);
+        sink_floor_.store(floor, std::memory_order_relaxed);
+        slot_.store(std::move(slot));
     }
 
-private:
-    std::unique_ptr<LogSink> sink_;
-    Logger() {
-        set_sink(SinkType::CONSOLE);
+    void dispatch_record(LogLevel level, std::string_view format, const LogArg* args, std::size_t count) {
+        thread_local std::array<char, kMaxMessage> record;
+        std::size_t size = encode_log_record(record.data(), record.size(), FormatRegistry::instance().id(format),
+                                             level, log_timestamp(), args, count);
+        dispatch(level, true, std::string_view(record.data(), size));
     }
 
-    Logger(const Logger&) = delete;
-    Logger& operator=(const Logger&) = delete;
+    void dispatch(LogLevel level, bool record, std::string_view data) {
+        if (auto async = async_.load()) {
+            async->enqueue(level, record, data);
+            return;
+        }
+
+        ThreadBuffer& buffer = thread_buffer();
+        bool full = false;
+        {
+            std::lock_guard<std::mutex> lock(buffer.mutex);
+            buffer.append(level, record, data);
+            full = buffer.count >= kMaxThreadBuffered;
+        }
+
+        // ERROR чекає на sink, а не лишається в буфері потоку.
+        auto slot = slot_.load();
+        std::mutex& write_mutex = *slot->write_mutex;
+        if (full || level >= LogLevel::ERROR) {
+            write_mutex.lock();
+        } else if (!write_mutex.try_lock()) {
+            // Потік, що тримає sink, перевірить pending_ після unlock. Друга
+            // спроба потрібна, якщо він відпустив sink до того, як прапорець
+            // з'явився: тоді sink уже вільний.
+            pending_.store(true);
+            if (!write_mutex.try_lock()) {
+                return;
+            }
+        }
+
+        if (pending_.load() && pending_.exchange(false)) {
+            drain_all(*slot);
+        } else {
+            std::lock_guard<std::mutex> lock(buffer.mutex);
+            buffer.drain_to(*slot);
+        }
+        write_mutex.unlock();
+        drain_pending(*slot);
+    }
+
+    // Викликається під write_mutex слоту: зливає буфери всіх потоків.
+    void drain_all(const SinkSlot& slot) {
+        std::lock_guard<std::mutex> registry_lock(registry_mutex_);
+        for (ThreadBuffer* buffer : buffers_) {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            buffer->drain_to(slot);
+        }
+    }
+
+    // Викликається після того, як write_mutex відпущено: дописує буфери потоків,
+    // яким не вдалося захопити sink, поки його тримав цей потік.
+    void drain_pending(const SinkSlot& slot) {
+        while (pending_.load() && slot.write_mutex->try_lock()) {
+            pending_.store(false);
+            drain_all(slot);
+            slot.write_mutex->unlock();
+        }
+    }
+
+    ThreadBuffer& thread_buffer() {
+        thread_local ThreadBufferHolder holder(*this);
+        return holder.get();
+    }
+
+    void stop_async() {
+        if (auto async = async_.exchange(nullptr)) {
+            AsyncState::stop(std::move(async));
+        }
+    }
 };
 
-SinkType parse_sink_type(const std::string& input) {
+std::string to_lower(const std::string& input) {
     std::string s = input;
     std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
         return std::tolower(c);
     });
+    return s;
+}
+
+#define LOG_AT(level, ...)                                     \
+    do {                                                       \
+        if constexpr ((level) >= kCompiledMinLevel) {          \
+            if (Logger::instance().enabled(level)) {           \
+                Logger::instance().log((level), __VA_ARGS__);  \
+            }                                                  \
+        }                                                      \
+    } while (0)
+
+#define LOG_TRACE(...) LOG_AT(LogLevel::TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::ERROR, __VA_ARGS__)
+
+SinkType parse_sink_type(const std::string& input) {
+    std::string s = to_lower(input);
 
     if (s == "console") return SinkType::CONSOLE;
     if (s == "file") return SinkType::FILE;
     if (s == "none") return SinkType::NONE;
+    if (s == "binary") return SinkType::BINARY;
+    if (s == "mmap") return SinkType::MMAP;
 
     throw std::invalid_argument("Unknown sink type: " + input);
 }
 
+LogLevel parse_log_level(const std::string& input) {
+    std::string s = to_lower(input);
+
+    if (s == "trace") return LogLevel::TRACE;
+    if (s == "debug") return LogLevel::DEBUG;
+    if (s == "info") return LogLevel::INFO;
+    if (s == "warn") return LogLevel::WARN;
+    if (s == "error") return LogLevel::ERROR;
+    if (s == "off") return LogLevel::OFF;
+
+    throw std::invalid_argument("Unknown log level: " + input);
+}
+
+OverflowPolicy parse_overflow_policy(const std::string& input) {
+    std::string s = to_lower(input);
+
+    if (s == "block") return OverflowPolicy::BLOCK;
+    if (s == "drop-newest") return OverflowPolicy::DROP_NEWEST;
+    if (s == "drop-oldest") return OverflowPolicy::DROP_OLDEST;
+
+    throw std::invalid_argument("Unknown overflow policy: " + input);
+}
+
+#ifndef LOGGER_NO_MAIN
 int main(int argc, char* argv[]) {
     try {
-        SinkType type = SinkType::CONSOLE;
-        if (argc >= 2) {
-            type = parse_sink_type(argv[1]);
-        } else {
+        std::vector<std::pair<SinkType, LogLevel>> sinks;
+        bool async = false;
+        OverflowPolicy policy = OverflowPolicy::BLOCK;
+        SinkSettings settings;
+        LogLevel level = LogLevel::INFO;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--async") {
+                async = true;
+            } else if (arg.rfind("--async=", 0) == 0) {
+                async = true;
+                policy = parse_overflow_policy(arg.substr(8));
+            } else if (arg.rfind("--file=", 0) == 0) {
+                settings.file_path = arg.substr(7);
+            } else if (arg.rfind("--binary-file=", 0) == 0) {
+                settings.binary_path = arg.substr(14);
+            } else if (arg.rfind("--ring-file=", 0) == 0) {
+                settings.ring_path = arg.substr(12);
+            } else if (arg == "--buffered-console") {
+                settings.console_buffered = true;
+            } else if (arg.rfind("--ring-capacity=", 0) == 0) {
+                settings.ring_capacity = std::stoull(arg.substr(16));
+            } else if (arg.rfind("--level=", 0) == 0) {
+                level = parse_log_level(arg.substr(8));
+            } else {
+                // name[:level] — поріг окремого sink'а.
+                std::size_t colon = arg.find(':');
+                LogLevel sink_level = colon == std::string::npos ? LogLevel::TRACE
+                                                                 : parse_log_level(arg.substr(colon + 1));
+                sinks.emplace_back(parse_sink_type(arg.substr(0, colon)), sink_level);
+            }
+        }
+        // До першого виводу програми, в тому числі від Logger.
+        if (settings.console_buffered) {
+            unsync_console_from_stdio();
+        }
+        if (sinks.empty()) {
             std::cout << "No sink type specified. Using default: CONSOLE.\n";
+            sinks.emplace_back(SinkType::CONSOLE, LogLevel::TRACE);
         }
 
-        Logger::instance().set_sink(type);
+        Logger::instance().configure(settings);
+        Logger::instance().set_sink(sinks[0].first, sinks[0].second);
+        for (std::size_t i = 1; i < sinks.size(); ++i) {
+            Logger::instance().add_sink(sinks[i].first, sinks[i].second);
+        }
+        Logger::instance().set_async(async, 8192, policy);
+        Logger::instance().set_level(level);
+        LOG_DEBUG("Debug message {}", 0);
         Logger::instance().log("Test message 1");
         Logger::instance().log("Test message 2");
         Logger::instance().log("Test message 3");
+        Logger::instance().log("Test message {} of {}", 4, 4);
+        Logger::instance().flush();
 
+        if (async && Logger::instance().dropped_messages() > 0) {
+            std::cout << "Dropped messages: " << Logger::instance().dropped_messages() << "\n";
+        }
         std::cout << "Logging complete.\n";
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << "\n";
-        std::cerr << "Valid options: console, file, none\n";
+        std::cerr << "Valid options: console|file|none|binary|mmap[:LEVEL] ... [--async[=block|drop-newest|drop-oldest]] [--file=PATH] [--binary-file=PATH] [--ring-file=PATH] [--ring-capacity=BYTES] [--buffered-console] [--level=trace|debug|info|warn|error|off]\n";
         return 1;
     }
 
     return 0;
 }
+#endif